@@ -0,0 +1,139 @@
+/*
+ * Times the OLSR data forwarding paths on real ns-3 packets
+ *
+ * Each run copies a received data packet, as the ether does for each
+ * receiver, and then rewrites its OLSR header in one of these ways:
+ * * full: removes the whole Header, decrements the TTL of the Message and
+ *   adds a new Header, as HandleData() does
+ * * peek + remove: peeks at the DataForwardHeader prefix, then removes it
+ *   and adds the changed prefix, as ForwardData() did before
+ * * remove: removes the prefix once and adds the changed prefix, as
+ *   ForwardData() does now
+ * For packets that are not forwarded, it compares peeking at the prefix
+ * with removing it and adding it back. A copy-only run gives the baseline.
+ * All forwarding paths must produce the same bytes.
+ *
+ * Usage: forwarding_benchmark [packet count] [payload size]
+ */
+#include "network/olsr/header.h"
+#include <ns3/packet.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace olsr;
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+/**
+ * Runs a function on a copy of a packet count times and returns the
+ * average time in nanoseconds
+ *
+ * The function returns a value that is summed into *checksum, so that the
+ * work is not optimized away.
+ */
+template <typename F>
+double time_runs(const ns3::Packet& received, std::uint32_t count, std::uint64_t* checksum, F function) {
+    const auto start = clock_type::now();
+    for (std::uint32_t i = 0; i < count; i++) {
+        ns3::Packet packet = received;
+        *checksum += function(packet);
+    }
+    return std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / count;
+}
+
+std::uint8_t forward_full(ns3::Packet& packet) {
+    Header header;
+    packet.RemoveHeader(header);
+    auto& message = header.GetMessage();
+    message.DecrementTtl();
+    packet.AddHeader(Header(message));
+    return message.Ttl();
+}
+
+std::uint8_t forward_peek_remove(ns3::Packet& packet) {
+    DataForwardHeader prefix;
+    packet.PeekHeader(prefix);
+    if (!prefix.IsData()) {
+        return 0;
+    }
+    packet.RemoveHeader(prefix);
+    prefix.DecrementTtl();
+    packet.AddHeader(prefix);
+    return prefix.Ttl();
+}
+
+std::uint8_t forward_remove(ns3::Packet& packet) {
+    DataForwardHeader prefix;
+    packet.RemoveHeader(prefix);
+    if (!prefix.IsData()) {
+        packet.AddHeader(prefix);
+        return 0;
+    }
+    prefix.DecrementTtl();
+    packet.AddHeader(prefix);
+    return prefix.Ttl();
+}
+
+std::vector<std::uint8_t> packet_bytes(const ns3::Packet& packet) {
+    std::vector<std::uint8_t> bytes(packet.GetSize());
+    packet.CopyData(bytes.data(), static_cast<std::uint32_t>(bytes.size()));
+    return bytes;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const std::uint32_t count = argc > 1 ? static_cast<std::uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 1000000;
+    const std::uint32_t payload_size = argc > 2 ? static_cast<std::uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 32;
+    if (count == 0) {
+        std::cerr << "Usage: forwarding_benchmark [packet count] [payload size]\n";
+        return 1;
+    }
+
+    ns3::Packet data(payload_size);
+    data.AddHeader(Header(Message::Data(IcaoAddress(0x123456), IcaoAddress(0x654321), 8, static_cast<std::uint16_t>(payload_size))));
+    // A packet that is not forwarded: a Hello from a node with a few neighbors
+    NeighborTable neighbors(ns3::Minutes(1));
+    for (std::uint32_t i = 1; i <= 8; i++) {
+        neighbors.Insert(NeighborTableEntry(IcaoAddress(i), LinkState::Bidirectional));
+    }
+    ns3::Packet hello;
+    hello.AddHeader(Header(Message::Hello(neighbors)));
+
+    // All forwarding paths must write the same header
+    ns3::Packet full_result = data;
+    forward_full(full_result);
+    ns3::Packet peek_result = data;
+    forward_peek_remove(peek_result);
+    ns3::Packet remove_result = data;
+    forward_remove(remove_result);
+    ns3::Packet hello_result = hello;
+    forward_remove(hello_result);
+    const auto expected = packet_bytes(full_result);
+    const bool matched = packet_bytes(peek_result) == expected && packet_bytes(remove_result) == expected
+        && packet_bytes(hello_result) == packet_bytes(hello);
+
+    std::uint64_t checksum = 0;
+    const auto copy_time = time_runs(data, count, &checksum, [](ns3::Packet& packet) {
+        return packet.GetSize();
+    });
+    const auto full_time = time_runs(data, count, &checksum, forward_full);
+    const auto peek_remove_time = time_runs(data, count, &checksum, forward_peek_remove);
+    const auto remove_time = time_runs(data, count, &checksum, forward_remove);
+    const auto hello_peek_time = time_runs(hello, count, &checksum, forward_peek_remove);
+    const auto hello_remove_time = time_runs(hello, count, &checksum, forward_remove);
+
+    std::cout << count << " packets, " << payload_size << " byte payload, nanoseconds per packet\n"
+        << "copy only: " << copy_time << '\n'
+        << "forwarded, full header: " << full_time << '\n'
+        << "forwarded, peek + remove prefix: " << peek_remove_time << '\n'
+        << "forwarded, remove prefix: " << remove_time << '\n'
+        << "not forwarded, peek prefix: " << hello_peek_time << '\n'
+        << "not forwarded, remove and restore prefix: " << hello_remove_time << '\n'
+        << "checksum " << checksum << (matched ? "" : ", FORWARDED HEADERS DIFFER") << '\n';
+    return matched ? 0 : 1;
+}
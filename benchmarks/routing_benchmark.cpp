@@ -0,0 +1,117 @@
+/*
+ * Times OLSR route calculation on random topology tables
+ *
+ * For each table size, this times a full calculate_routes() and then
+ * update_routes() after single last-hop changes, checking that the
+ * incremental result matches a full calculation.
+ *
+ * Usage: routing_benchmark [table sizes...]
+ */
+#include "network/olsr/routing_calc.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace olsr;
+
+namespace {
+
+/** Number of symmetric neighbors of the calculating node */
+const std::uint32_t neighbor_count = 30;
+/** Number of full calculations timed for each size */
+const unsigned int full_runs = 20;
+/** Number of incremental updates timed for each size */
+const unsigned int update_runs = 200;
+
+typedef std::chrono::steady_clock clock_type;
+
+double microseconds_since(clock_type::time_point start) {
+    return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+}
+
+bool same_routes(const RoutingTable& a, const RoutingTable& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    auto in_b = b.begin();
+    for (const auto& entry : a) {
+        if (entry.Destination() != in_b->Destination() || entry.NextHop() != in_b->NextHop()
+            || entry.Distance() != in_b->Distance()) {
+            return false;
+        }
+        ++in_b;
+    }
+    return true;
+}
+
+/**
+ * Runs the benchmark for one topology table size
+ *
+ * Returns false if an incremental update gave different routes than a
+ * full calculation.
+ */
+bool run(std::uint32_t size, std::mt19937& random) {
+    NeighborTable neighbors(ns3::Minutes(21));
+    for (std::uint32_t i = 1; i <= neighbor_count; i++) {
+        neighbors.Insert(NeighborTableEntry(IcaoAddress(i), LinkState::Bidirectional));
+    }
+    // Each destination's last hop is a neighbor or an earlier destination,
+    // so every destination is reachable
+    TopologyTable topology(ns3::Minutes(61));
+    const auto first = neighbor_count + 1;
+    const auto last = neighbor_count + size;
+    for (auto destination = first; destination <= last; destination++) {
+        const auto last_hop = std::uniform_int_distribution<std::uint32_t>(1, destination - 1)(random);
+        topology.Insert(TopologyTable::Entry(IcaoAddress(destination), IcaoAddress(last_hop), 0));
+    }
+
+    RoutingTable full;
+    auto start = clock_type::now();
+    for (unsigned int i = 0; i < full_runs; i++) {
+        calculate_routes(&full, neighbors, topology);
+    }
+    const auto full_time = microseconds_since(start) / full_runs;
+
+    RoutingTable incremental = full;
+    double update_time = 0;
+    bool matched = true;
+    for (unsigned int i = 0; i < update_runs; i++) {
+        const auto destination = std::uniform_int_distribution<std::uint32_t>(first, last)(random);
+        const auto last_hop = std::uniform_int_distribution<std::uint32_t>(1, destination - 1)(random);
+        topology.SetLastHop(topology.Find(IcaoAddress(destination)), IcaoAddress(last_hop));
+        const std::set<IcaoAddress> changed { IcaoAddress(destination) };
+        start = clock_type::now();
+        update_routes(&incremental, neighbors, topology, changed);
+        update_time += microseconds_since(start);
+
+        calculate_routes(&full, neighbors, topology);
+        matched = matched && same_routes(full, incremental);
+    }
+    update_time /= update_runs;
+
+    std::cout << size << " topology entries: full " << full_time << " us, incremental "
+        << update_time << " us, " << full.size() << " routes"
+        << (matched ? "" : ", INCREMENTAL ROUTES DIFFER") << '\n';
+    return matched;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::uint32_t> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(static_cast<std::uint32_t>(std::strtoul(argv[i], nullptr, 10)));
+    }
+    if (sizes.empty()) {
+        sizes = { 1000, 10000 };
+    }
+    std::mt19937 random(1);
+    bool matched = true;
+    for (const auto size : sizes) {
+        matched = run(size, random) && matched;
+    }
+    return matched ? 0 : 1;
+}
@@ -7,6 +7,9 @@ another foler
 
 Usage: filter_flights.rb source-directory transatlantic-directory
 
+The simulation can also filter flights directly, without copying files:
+simulation --transatlantic source-directory
+
 =end
 
 require 'nokogiri'
@@ -0,0 +1,83 @@
+#include "flight_description.h"
+#include <cctype>
+#include <fstream>
+
+namespace flightkml {
+namespace detail {
+
+namespace {
+
+/**
+ * Finds the first sequence of exactly four uppercase ASCII letters in text
+ * and writes it to code
+ *
+ * Returns true if a code was found
+ */
+bool find_airport_code(const std::string& text, std::string* code) {
+    std::size_t run = 0;
+    for (std::size_t i = 0; i <= text.size(); i++) {
+        if (i < text.size() && std::isupper(static_cast<unsigned char>(text[i]))) {
+            run++;
+        } else {
+            if (run == 4) {
+                *code = text.substr(i - 4, 4);
+                return true;
+            }
+            run = 0;
+        }
+    }
+    return false;
+}
+
+}
+
+int parse_flight_description(const std::string& name, std::string* origin, std::string* destination, std::string* error) {
+    // Airports follow the last airplane symbol (U+2708, UTF-8 encoded)
+    static const std::string airplane = "\xe2\x9c\x88";
+    const auto last_airplane = name.rfind(airplane);
+    const auto airports = last_airplane == std::string::npos ? name : name.substr(last_airplane + airplane.size());
+    const auto separator = airports.find(" - ");
+    if (separator == std::string::npos) {
+        *error = "No origin - destination separator in flight description " + name;
+        return -1;
+    }
+    if (!find_airport_code(airports.substr(0, separator), origin)) {
+        *error = "Failed to parse origin airport code in " + name;
+        return -1;
+    }
+    if (!find_airport_code(airports.substr(separator + 3), destination)) {
+        *error = "Failed to parse destination airport code in " + name;
+        return -1;
+    }
+    return 0;
+}
+
+int scan_kml_airports(const std::string& path, std::string* origin, std::string* destination, std::string* error) {
+    std::ifstream file(path);
+    if (!file) {
+        *error = "Can't open " + path;
+        return -1;
+    }
+    // The document name comes before the first Placemark
+    std::string head;
+    std::string line;
+    while (std::getline(file, line)) {
+        head += line;
+        head += '\n';
+        if (line.find("<Placemark") != std::string::npos) {
+            break;
+        }
+    }
+    const auto document = head.find("<Document>");
+    const auto name_start = head.find("<name>", document == std::string::npos ? 0 : document);
+    const auto name_end = head.find("</name>", name_start);
+    if (document == std::string::npos || name_start == std::string::npos || name_end == std::string::npos) {
+        *error = "No document name in " + path;
+        return -1;
+    }
+    const auto text_start = name_start + 6;
+    return parse_flight_description(head.substr(text_start, name_end - text_start), origin, destination, error);
+}
+
+}
+}
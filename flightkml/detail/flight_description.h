@@ -0,0 +1,37 @@
+#ifndef FLIGHTKML_DETAIL_FLIGHT_DESCRIPTION_H
+#define FLIGHTKML_DETAIL_FLIGHT_DESCRIPTION_H
+
+#include <string>
+
+namespace flightkml {
+namespace detail {
+
+/**
+ * Parses the origin and destination airport ICAO codes from a FlightAware
+ * KML document name
+ *
+ * The name has the form "FlightAware ✈ AAL100 ✈ 15-Mar-2018  ✈ KJFK - LHR / EGLL".
+ * The first four-uppercase-letter word on each side of the last " - " is
+ * the airport code.
+ *
+ * On success, returns 0 and writes to origin and destination
+ * On failure, returns -1 and writes an error message to error
+ */
+int parse_flight_description(const std::string& name, std::string* origin, std::string* destination, std::string* error);
+
+/**
+ * Reads the origin and destination airport codes from a KML file without
+ * parsing the whole file
+ *
+ * This only reads the beginning of the file, up to the end of the document
+ * name, so it is much faster than Flight::read_from_kml().
+ *
+ * On success, returns 0 and writes to origin and destination
+ * On failure, returns -1 and writes an error message to error
+ */
+int scan_kml_airports(const std::string& path, std::string* origin, std::string* destination, std::string* error);
+
+}
+}
+
+#endif
@@ -20,6 +20,9 @@ const std::vector<LatLonAlt>& FlightSaxParser::lat_lon_alt() const {
 const std::vector<boost::posix_time::ptime>& FlightSaxParser::time() const {
     return _time;
 }
+const Glib::ustring& FlightSaxParser::document_name() const {
+    return _document_name;
+}
 
 void FlightSaxParser::on_start_document() {
     // Initialize
@@ -28,9 +31,13 @@ void FlightSaxParser::on_start_document() {
     _fatal_errors.clear();
     _lat_lon_alt.clear();
     _time.clear();
+    _document_name.clear();
     _in_track = false;
     _in_when = false;
     _in_coord = false;
+    _depth = 0;
+    _document_depth = 0;
+    _in_document_name = false;
 }
 void FlightSaxParser::on_end_document() {
     // Check lat/lon/alt and time matching
@@ -52,6 +59,13 @@ void FlightSaxParser::on_start_element(const Glib::ustring& name, const Attribut
     if (name == "gx:coord") {
         _in_coord = true;
     }
+    _depth++;
+    if (name == "Document") {
+        _document_depth = _depth;
+    }
+    if (name == "name" && _document_depth != 0 && _depth == _document_depth + 1) {
+        _in_document_name = true;
+    }
 }
 void FlightSaxParser::on_end_element(const Glib::ustring& name) {
     if (name == "gx:Track") {
@@ -63,8 +77,18 @@ void FlightSaxParser::on_end_element(const Glib::ustring& name) {
     if (name == "gx:coord") {
         _in_coord = false;
     }
+    if (name == "Document") {
+        _document_depth = 0;
+    }
+    if (name == "name") {
+        _in_document_name = false;
+    }
+    _depth--;
 }
 void FlightSaxParser::on_characters(const Glib::ustring& text) {
+    if (_in_document_name) {
+        _document_name += text;
+    }
     if (_in_track && _in_when) {
 
         boost::posix_time::ptime time;
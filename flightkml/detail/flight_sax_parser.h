@@ -27,6 +27,8 @@ private:
     std::vector<LatLonAlt> _lat_lon_alt;
     /** Time entries, in UTC */
     std::vector<boost::posix_time::ptime> _time;
+    /** Text of the name of the document, which describes the flight */
+    Glib::ustring _document_name;
 
     // Parsing state
     /** In a <gx:Track> element */
@@ -35,6 +37,12 @@ private:
     bool _in_when;
     /** In a <gx:coord> element, expecting coordinates */
     bool _in_coord;
+    /** Number of elements that the parser is in */
+    unsigned int _depth;
+    /** Depth of the <Document> element, or 0 if not in a document */
+    unsigned int _document_depth;
+    /** In a <name> element that is a child of <Document> */
+    bool _in_document_name;
 
 public:
     FlightSaxParser() = default;
@@ -46,6 +54,7 @@ public:
 
     const std::vector<LatLonAlt>& lat_lon_alt() const;
     const std::vector<boost::posix_time::ptime>& time() const;
+    const Glib::ustring& document_name() const;
 
 protected:
     virtual void on_start_document() override;
@@ -1,6 +1,7 @@
 #include "flight.h"
 #include "detail/flight_sax_parser.h"
 #include "detail/lat_lon_alt.h"
+#include "detail/flight_description.h"
 
 #include <libxml++/libxml++.h>
 
@@ -8,15 +9,99 @@
 #include <stdexcept>
 #include <ctime>
 #include <cstring>
+#include <limits>
 #include <iomanip>
 #include <algorithm>
+#include <cstdint>
 
 namespace flightkml {
 
-Flight::Flight(std::vector<Point>&& points) :
-    _points(points)
-{
+namespace {
+
+/** Magic bytes at the beginning of a binary flight, including the version */
+const char BINARY_MAGIC[8] = { 'F', 'K', 'M', 'L', 'B', 'I', 'N', 3 };
+
+const boost::posix_time::ptime UNIX_EPOCH(boost::gregorian::date(1970, 1, 1));
+
+template <typename T>
+void write_value(std::ostream& stream, T value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof value);
+}
+
+template <typename T>
+T read_value(std::istream& stream) {
+    T value;
+    stream.read(reinterpret_cast<char*>(&value), sizeof value);
+    if (!stream) {
+        throw std::runtime_error("Unexpected end of binary flight");
+    }
+    return value;
+}
+
+void write_string(std::ostream& stream, const std::string& value) {
+    const auto length = static_cast<std::uint8_t>(std::min<std::size_t>(value.size(), 255));
+    write_value<std::uint8_t>(stream, length);
+    stream.write(value.data(), length);
+}
 
+std::string read_string(std::istream& stream) {
+    const auto length = read_value<std::uint8_t>(stream);
+    std::string value(length, '\0');
+    stream.read(&value[0], length);
+    if (!stream) {
+        throw std::runtime_error("Unexpected end of binary flight");
+    }
+    return value;
+}
+
+template <typename T>
+void write_column(std::ostream& stream, const std::vector<T>& column) {
+    stream.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+}
+
+/**
+ * Returns the number of bytes left in a stream, or the largest std::uint64_t
+ * if the stream can't seek
+ */
+std::uint64_t remaining_size(std::istream& stream) {
+    const auto position = stream.tellg();
+    if (position < 0) {
+        stream.clear();
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    stream.seekg(0, std::ios::end);
+    const auto end = stream.tellg();
+    stream.seekg(position);
+    if (end < position || !stream) {
+        stream.clear();
+        stream.seekg(position);
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return static_cast<std::uint64_t>(end - position);
+}
+
+template <typename T>
+void read_column(std::istream& stream, std::vector<T>* column, std::size_t size) {
+    column->resize(size);
+    stream.read(reinterpret_cast<char*>(column->data()), size * sizeof(T));
+    if (!stream) {
+        throw std::runtime_error("Unexpected end of binary flight");
+    }
+}
+
+}
+
+Flight::Flight(Trajectory&& points, std::string origin, std::string destination) :
+    _points(std::move(points)),
+    _departure(),
+    _arrival(),
+    _origin(std::move(origin)),
+    _destination(std::move(destination))
+{
+    if (!_points.empty()) {
+        _departure = _points.front().time();
+        _arrival = _points.back().time();
+    }
 }
 
 Flight Flight::read_from_kml(const std::string& path) {
@@ -34,38 +119,81 @@ Flight Flight::read_from_kml(const std::string& path) {
         std::cerr << "KML parse fatal error: " << error << '\n';
     }
 
+    std::string origin;
+    std::string destination;
+    std::string description_error;
+    if (detail::parse_flight_description(parser.document_name(), &origin, &destination, &description_error) != 0) {
+        std::cerr << "KML parse warning: " << description_error << '\n';
+    }
+
     // Convert lat/lon/alt into Points
     const auto lla = parser.lat_lon_alt();
     const auto time = parser.time();
     const auto point_count = std::min(lla.size(), time.size());
-    std::vector<Point> points;
+    Trajectory points;
     points.reserve(point_count);
     for (std::size_t i = 0; i < point_count; i++) {
-        const auto point = Point(time[i], lla[i].latitude, lla[i].longitude, lla[i].altitude);
-        points.emplace_back(std::move(point));
+        points.push_back(Point(time[i], lla[i].latitude, lla[i].longitude, lla[i].altitude));
     }
 
-    return Flight(std::move(points));
+    return Flight(std::move(points), std::move(origin), std::move(destination));
 }
 
-const std::vector<Point>& Flight::points() const {
+Flight Flight::read_binary(std::istream& stream) {
+    char magic[sizeof BINARY_MAGIC];
+    stream.read(magic, sizeof magic);
+    if (!stream || std::memcmp(magic, BINARY_MAGIC, sizeof magic) != 0) {
+        throw std::runtime_error("Not a binary flight, or unsupported version");
+    }
+    auto origin = read_string(stream);
+    auto destination = read_string(stream);
+    const auto start_microseconds = read_value<std::int64_t>(stream);
+    const auto stored_point_count = read_value<std::uint64_t>(stream);
+    Trajectory points;
+    // Check before allocating, so that a corrupt count can't exhaust memory
+    const std::uint64_t point_size = sizeof(points._seconds[0]) + sizeof(points._latitude[0])
+        + sizeof(points._longitude[0]) + sizeof(points._altitude[0]);
+    if (stored_point_count > remaining_size(stream) / point_size) {
+        throw std::runtime_error("Point count is larger than the binary flight");
+    }
+    const auto point_count = static_cast<std::size_t>(stored_point_count);
+    if (point_count != 0) {
+        points._start = UNIX_EPOCH + boost::posix_time::microseconds(start_microseconds);
+    }
+    read_column(stream, &points._seconds, point_count);
+    read_column(stream, &points._latitude, point_count);
+    read_column(stream, &points._longitude, point_count);
+    read_column(stream, &points._altitude, point_count);
+    return Flight(std::move(points), std::move(origin), std::move(destination));
+}
+
+void Flight::write_binary(std::ostream& stream) const {
+    stream.write(BINARY_MAGIC, sizeof BINARY_MAGIC);
+    write_string(stream, _origin);
+    write_string(stream, _destination);
+    const auto start = _points.empty() ? UNIX_EPOCH : _points.start_time();
+    write_value<std::int64_t>(stream, (start - UNIX_EPOCH).total_microseconds());
+    write_value<std::uint64_t>(stream, _points.size());
+    write_column(stream, _points._seconds);
+    write_column(stream, _points._latitude);
+    write_column(stream, _points._longitude);
+    write_column(stream, _points._altitude);
+}
+
+const Trajectory& Flight::points() const {
     return _points;
 }
 
+void Flight::release_points() {
+    _points.release();
+}
+
 boost::posix_time::ptime Flight::departure_time() const {
-    if (_points.empty()) {
-        return boost::posix_time::ptime();
-    } else {
-        return _points.front().time();
-    }
+    return _departure;
 }
 
 boost::posix_time::ptime Flight::arrival_time() const {
-    if (_points.empty()) {
-        return boost::posix_time::ptime();
-    } else {
-        return _points.back().time();
-    }
+    return _arrival;
 }
 
 }
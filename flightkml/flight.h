@@ -2,8 +2,11 @@
 #define FLIGHTKML_FLIGHT_H
 #include <string>
 #include <vector>
+#include <istream>
+#include <ostream>
 
 #include "point.h"
+#include "trajectory.h"
 
 namespace flightkml {
 
@@ -13,10 +16,18 @@ namespace flightkml {
 class Flight {
 private:
     /** The points that define this flight */
-    std::vector<Point> _points;
+    Trajectory _points;
+    /** Time of the first point, kept when the points are released */
+    boost::posix_time::ptime _departure;
+    /** Time of the last point, kept when the points are released */
+    boost::posix_time::ptime _arrival;
+    /** ICAO code of the origin airport, or empty if unknown */
+    std::string _origin;
+    /** ICAO code of the destination airport, or empty if unknown */
+    std::string _destination;
 
-    /** Creates a Flight from a vector of points */
-    Flight(std::vector<Point>&& points);
+    /** Creates a Flight from a trajectory and airport codes */
+    Flight(Trajectory&& points, std::string origin, std::string destination);
 public:
     /**
      * Reads a flight from a Google Earth-compatible KML file
@@ -24,8 +35,50 @@ public:
      */
     static Flight read_from_kml(const std::string& path);
 
-    /** Returns the points in this flight */
-    const std::vector<Point>& points() const;
+    /**
+     * Reads a flight in the binary format written by write_binary()
+     *
+     * Throws std::runtime_error if the data are not a valid binary flight.
+     */
+    static Flight read_binary(std::istream& stream);
+
+    /**
+     * Writes this flight to a stream in a compact binary format
+     *
+     * Format (native byte order, intended only for local caches):
+     * * Magic "FKMLBIN" and a 1-byte format version
+     * * Origin and destination airport codes, each a 1-byte length and
+     *   that many characters
+     * * Time of the first point, microseconds since 1970-01-01 UTC, 8 bytes
+     * * Number of points, 8 bytes
+     * * The columns of the trajectory (see Trajectory), one after another:
+     *   times, latitudes, longitudes, and altitudes, 4 bytes per point each
+     */
+    void write_binary(std::ostream& stream) const;
+
+    /**
+     * Returns the points in this flight
+     *
+     * The returned trajectory can be iterated over like a container of Points.
+     */
+    const Trajectory& points() const;
+
+    /** Returns the ICAO code of the origin airport, or an empty string if unknown */
+    inline const std::string& origin() const {
+        return _origin;
+    }
+    /** Returns the ICAO code of the destination airport, or an empty string if unknown */
+    inline const std::string& destination() const {
+        return _destination;
+    }
+
+    /**
+     * Frees the memory used for the points in this flight
+     *
+     * After this, points() is empty, but departure_time() and arrival_time()
+     * still return the times of the original first and last points.
+     */
+    void release_points();
 
     /**
      * Returns the departure time of this flight
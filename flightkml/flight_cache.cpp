@@ -0,0 +1,188 @@
+#include "flight_cache.h"
+#include "detail/flight_description.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = boost::filesystem;
+
+namespace flightkml {
+
+namespace {
+
+/**
+ * Calculates a hash of the content of a file and returns it as a string
+ *
+ * The hash is the 64-bit FNV-1a hash of the content followed by the size
+ * of the file, both in hexadecimal.
+ */
+std::string hash_file(const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Can't open " + path);
+    }
+    std::uint64_t hash = 0xcbf29ce484222325;
+    std::uint64_t size = 0;
+    char buffer[65536];
+    while (file) {
+        file.read(buffer, sizeof buffer);
+        const auto count = file.gcount();
+        for (std::streamsize i = 0; i < count; i++) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 0x100000001b3;
+        }
+        size += static_cast<std::uint64_t>(count);
+    }
+    std::ostringstream stream;
+    stream << std::hex << std::setw(16) << std::setfill('0') << hash << '-' << size;
+    return stream.str();
+}
+
+}
+
+FlightCache::FlightCache(const std::string& directory) :
+    _directory(directory),
+    _index_changed(false),
+    _parsed_count(0),
+    _cached_count(0),
+    _rejected_count(0)
+{
+    fs::create_directories(_directory);
+    ReadIndex();
+}
+
+void FlightCache::ReadIndex() {
+    std::ifstream file((fs::path(_directory) / "index").native());
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream line_stream(line);
+        IndexEntry entry;
+        std::string path;
+        line_stream >> entry.hash >> entry.size >> entry.modified;
+        // Path is the rest of the line, and may contain spaces
+        line_stream.ignore(1);
+        std::getline(line_stream, path);
+        if (line_stream && !path.empty()) {
+            _index[path] = entry;
+        } else {
+            std::cerr << "Ignoring invalid flight cache index line: " << line << '\n';
+        }
+    }
+}
+
+std::string FlightCache::FlightPath(const std::string& hash) const {
+    return (fs::path(_directory) / (hash + ".flight")).native();
+}
+
+std::string FlightCache::ContentHash(const std::string& path) {
+    const auto size = fs::file_size(path);
+    const auto modified = fs::last_write_time(path);
+
+    const auto in_index = _index.find(path);
+    if (in_index != _index.end() && in_index->second.size == size && in_index->second.modified == modified) {
+        return in_index->second.hash;
+    } else {
+        const auto hash = hash_file(path);
+        _index[path] = IndexEntry { size, modified, hash };
+        _index_changed = true;
+        return hash;
+    }
+}
+
+boost::optional<Flight> FlightCache::ReadCached(const std::string& hash) {
+    const auto flight_path = FlightPath(hash);
+    std::ifstream cached(flight_path, std::ios::in | std::ios::binary);
+    if (cached) {
+        try {
+            auto flight = Flight::read_binary(cached);
+            _cached_count++;
+            return boost::optional<Flight>(std::move(flight));
+        } catch (std::exception& e) {
+            // Corrupt data can also cause allocation or range errors
+            std::cerr << "Ignoring invalid cached flight " << flight_path << ": " << e.what() << '\n';
+        }
+    }
+    return boost::none;
+}
+
+Flight FlightCache::ParseAndStore(const std::string& path, const std::string& hash) {
+    auto flight = Flight::read_from_kml(path);
+    _parsed_count++;
+    // Write to a temporary file first so that an interrupted write does not
+    // leave a truncated flight
+    const auto flight_path = FlightPath(hash);
+    const auto temp_path = flight_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+        flight.write_binary(out);
+        out.close();
+        if (!out) {
+            std::cerr << "Can't write cached flight " << temp_path << '\n';
+            return flight;
+        }
+    }
+    fs::rename(temp_path, flight_path);
+    return flight;
+}
+
+Flight FlightCache::read(const std::string& kml_path) {
+    const auto path = fs::absolute(kml_path).native();
+    const auto hash = ContentHash(path);
+    auto cached = ReadCached(hash);
+    if (cached) {
+        return std::move(*cached);
+    }
+    return ParseAndStore(path, hash);
+}
+
+boost::optional<Flight> FlightCache::read_if(const std::string& kml_path, const FlightFilter& filter) {
+    const auto path = fs::absolute(kml_path).native();
+    const auto hash = ContentHash(path);
+    auto flight = ReadCached(hash);
+    if (!flight) {
+        // Check the airports before parsing the whole file
+        std::string origin;
+        std::string destination;
+        std::string error;
+        if (detail::scan_kml_airports(path, &origin, &destination, &error) == 0
+            && !filter.matches_airports(origin, destination)) {
+            _rejected_count++;
+            return boost::none;
+        }
+        flight = ParseAndStore(path, hash);
+    }
+    if (!filter.matches(*flight)) {
+        _rejected_count++;
+        return boost::none;
+    }
+    return flight;
+}
+
+void FlightCache::save() {
+    if (!_index_changed) {
+        return;
+    }
+    const auto index_path = fs::path(_directory) / "index";
+    const auto temp_path = fs::path(_directory) / "index.tmp";
+    {
+        std::ofstream file(temp_path.native(), std::ios::out | std::ios::trunc);
+        for (const auto& entry : _index) {
+            file << entry.second.hash << ' ' << entry.second.size << ' '
+                << entry.second.modified << ' ' << entry.first << '\n';
+        }
+        file.close();
+        if (!file) {
+            std::cerr << "Can't write flight cache index " << temp_path.native() << '\n';
+            return;
+        }
+    }
+    fs::rename(temp_path, index_path);
+    _index_changed = false;
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef FLIGHTKML_FLIGHT_CACHE_H
+#define FLIGHTKML_FLIGHT_CACHE_H
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+#include <boost/optional.hpp>
+
+#include "flight.h"
+#include "flight_filter.h"
+
+namespace flightkml {
+
+/**
+ * An on-disk cache of parsed flights
+ *
+ * Each distinct KML file content is parsed once and stored in the binary
+ * format written by Flight::write_binary(), named by a hash of the content.
+ * Datasets that share files (for example, a filtered copy of another
+ * dataset) therefore share cache entries.
+ *
+ * An index records the size, modification time, and content hash of every
+ * KML file that has been read. If the size and modification time of a file
+ * have not changed, the file is not read or hashed again.
+ *
+ * Cache directory layout:
+ * * index: one line per KML file: content hash, size, modification time, path
+ * * <content hash>.flight: a binary flight
+ */
+class FlightCache {
+private:
+    /** Information about a KML file when it was last read */
+    struct IndexEntry {
+        /** File size, bytes */
+        std::uintmax_t size;
+        /** Modification time */
+        std::time_t modified;
+        /** Content hash, used as the name of the binary flight file */
+        std::string hash;
+    };
+
+    /** The cache directory */
+    std::string _directory;
+    /** Absolute KML path -> index entry */
+    std::map<std::string, IndexEntry> _index;
+    /** True if _index has changed since it was last read or saved */
+    bool _index_changed;
+    /** Number of flights parsed from KML */
+    std::size_t _parsed_count;
+    /** Number of flights read from the cache */
+    std::size_t _cached_count;
+    /** Number of flights that did not match a filter */
+    std::size_t _rejected_count;
+
+    void ReadIndex();
+    /** Returns the path to the binary flight file with the provided hash */
+    std::string FlightPath(const std::string& hash) const;
+    /**
+     * Returns the content hash of the file at an absolute path, using the
+     * index if the file has not changed
+     */
+    std::string ContentHash(const std::string& path);
+    /** Reads the cached flight with the provided hash, if it exists and is valid */
+    boost::optional<Flight> ReadCached(const std::string& hash);
+    /** Parses a KML file and stores the flight in the cache */
+    Flight ParseAndStore(const std::string& path, const std::string& hash);
+
+public:
+    /**
+     * Opens a cache in the provided directory, creating the directory if it
+     * does not exist
+     */
+    explicit FlightCache(const std::string& directory);
+
+    /**
+     * Reads a flight from a KML file, or from the cache if the cache has
+     * a flight for the current content of the file
+     */
+    Flight read(const std::string& kml_path);
+
+    /**
+     * Reads a flight like read(), but returns nothing if the flight does not
+     * match a filter
+     *
+     * If the flight is not in the cache and its airports do not match the
+     * filter, the KML file is not parsed.
+     */
+    boost::optional<Flight> read_if(const std::string& kml_path, const FlightFilter& filter);
+
+    /**
+     * Writes the index to disk if it has changed
+     *
+     * If the index cannot be written, prints a warning. The cache will still
+     * work, but files will be hashed again the next time they are read.
+     */
+    void save();
+
+    /** Returns the number of flights that were parsed from KML files */
+    inline std::size_t parsed_count() const {
+        return _parsed_count;
+    }
+    /** Returns the number of flights that were read from the cache */
+    inline std::size_t cached_count() const {
+        return _cached_count;
+    }
+    /** Returns the number of flights that read_if() rejected */
+    inline std::size_t rejected_count() const {
+        return _rejected_count;
+    }
+};
+
+}
+
+#endif
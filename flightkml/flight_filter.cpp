@@ -0,0 +1,175 @@
+#include "flight_filter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace flightkml {
+
+namespace {
+
+bool starts_with_any(const std::string& value, const std::vector<std::string>& prefixes) {
+    if (prefixes.empty()) {
+        return true;
+    }
+    return std::any_of(prefixes.begin(), prefixes.end(), [&value](const std::string& prefix) {
+        return value.compare(0, prefix.size(), prefix) == 0;
+    });
+}
+
+/** Wraps a difference of longitudes into [-180, 180] degrees */
+double wrap_longitude_difference(double difference) {
+    return std::remainder(difference, 360.0);
+}
+
+/**
+ * Returns true if a track crosses a line of longitude
+ *
+ * Each segment is taken to follow the shorter way around the Earth, so a
+ * segment from 179.9 to -179.9 crosses only the antimeridian.
+ */
+bool track_crosses_longitude(const Trajectory& points, double longitude) {
+    for (std::size_t i = 1; i < points.size(); i++) {
+        const auto start = points.longitude(i - 1);
+        const auto segment = wrap_longitude_difference(points.longitude(i) - start);
+        const auto target = wrap_longitude_difference(longitude - start);
+        if ((segment >= 0 && target >= 0 && target <= segment) || (segment <= 0 && target <= 0 && target >= segment)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+Region region_of_airport(const std::string& icao_code) {
+    if (icao_code.empty()) {
+        return Region::Other;
+    }
+    switch (icao_code[0]) {
+    case 'C':
+    case 'K':
+    case 'T':
+    case 'm':
+        return Region::NorthAmerica;
+    case 'B':
+    case 'E':
+    case 'L':
+        return Region::Europe;
+    default:
+        return Region::Other;
+    }
+}
+
+std::ostream& operator << (std::ostream& stream, const Region& region) {
+    switch (region) {
+    case Region::NorthAmerica:
+        stream << "North America";
+        break;
+    case Region::Europe:
+        stream << "Europe";
+        break;
+    case Region::Other:
+        stream << "other";
+        break;
+    }
+    return stream;
+}
+
+FlightFilter::FlightFilter() :
+    _origin_region(Region::Other),
+    _has_origin_region(false),
+    _destination_region(Region::Other),
+    _has_destination_region(false),
+    _between_first(Region::Other),
+    _between_second(Region::Other),
+    _has_between(false),
+    _window_start(),
+    _window_end(),
+    _has_window(false)
+{
+}
+
+FlightFilter FlightFilter::transatlantic() {
+    FlightFilter filter;
+    filter.between_regions(Region::NorthAmerica, Region::Europe);
+    return filter;
+}
+
+FlightFilter& FlightFilter::origin_region(Region region) {
+    _origin_region = region;
+    _has_origin_region = true;
+    return *this;
+}
+
+FlightFilter& FlightFilter::destination_region(Region region) {
+    _destination_region = region;
+    _has_destination_region = true;
+    return *this;
+}
+
+FlightFilter& FlightFilter::between_regions(Region first, Region second) {
+    _between_first = first;
+    _between_second = second;
+    _has_between = true;
+    return *this;
+}
+
+FlightFilter& FlightFilter::origin_prefix(const std::string& prefix) {
+    _origin_prefixes.push_back(prefix);
+    return *this;
+}
+
+FlightFilter& FlightFilter::destination_prefix(const std::string& prefix) {
+    _destination_prefixes.push_back(prefix);
+    return *this;
+}
+
+FlightFilter& FlightFilter::airborne_between(boost::posix_time::ptime start, boost::posix_time::ptime end) {
+    _window_start = start;
+    _window_end = end;
+    _has_window = true;
+    return *this;
+}
+
+FlightFilter& FlightFilter::crosses_longitude(double longitude) {
+    _crossed_longitudes.push_back(longitude);
+    return *this;
+}
+
+bool FlightFilter::matches_airports(const std::string& origin, const std::string& destination) const {
+    const auto origin_region = region_of_airport(origin);
+    const auto destination_region = region_of_airport(destination);
+    if (_has_origin_region && origin_region != _origin_region) {
+        return false;
+    }
+    if (_has_destination_region && destination_region != _destination_region) {
+        return false;
+    }
+    if (_has_between) {
+        const auto forward = origin_region == _between_first && destination_region == _between_second;
+        const auto backward = origin_region == _between_second && destination_region == _between_first;
+        if (!forward && !backward) {
+            return false;
+        }
+    }
+    return starts_with_any(origin, _origin_prefixes) && starts_with_any(destination, _destination_prefixes);
+}
+
+bool FlightFilter::matches(const Flight& flight) const {
+    if (!matches_airports(flight.origin(), flight.destination())) {
+        return false;
+    }
+    if (_has_window) {
+        if (flight.departure_time().is_special() || flight.departure_time() > _window_end
+            || flight.arrival_time() < _window_start) {
+            return false;
+        }
+    }
+    for (const auto longitude : _crossed_longitudes) {
+        if (!track_crosses_longitude(flight.points(), longitude)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,120 @@
+#ifndef FLIGHTKML_FLIGHT_FILTER_H
+#define FLIGHTKML_FLIGHT_FILTER_H
+#include <string>
+#include <vector>
+#include <ostream>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "flight.h"
+
+namespace flightkml {
+
+/**
+ * Regions that airports are classified into
+ */
+enum class Region {
+    /** ICAO codes starting with C, K, T, or lowercase m */
+    NorthAmerica,
+    /** ICAO codes starting with B, E, or L */
+    Europe,
+    /** Anything else */
+    Other,
+};
+std::ostream& operator << (std::ostream& stream, const Region& region);
+
+/**
+ * Returns the region of an airport based on its ICAO code
+ *
+ * The prefixes are the same as in filter_flights/filter_flights.rb,
+ * including lowercase m, which that script counts as North America.
+ */
+Region region_of_airport(const std::string& icao_code);
+
+/**
+ * A set of conditions that flights must meet
+ *
+ * A default-constructed filter accepts all flights. Each condition that is
+ * added must also be met. Conditions on airports can be checked without the
+ * points of a flight (see matches_airports()), so flights can be rejected
+ * without parsing their whole KML files.
+ *
+ * Example: transatlantic flights that arrive at Heathrow
+ *
+ *     auto filter = FlightFilter::transatlantic();
+ *     filter.destination_prefix("EGLL");
+ */
+class FlightFilter {
+private:
+    /** Required origin region, if _has_origin_region is true */
+    Region _origin_region;
+    bool _has_origin_region;
+    /** Required destination region */
+    Region _destination_region;
+    bool _has_destination_region;
+    /** Regions that the flight must connect, in either direction */
+    Region _between_first;
+    Region _between_second;
+    bool _has_between;
+    /** Prefixes of the origin ICAO code; any one must match */
+    std::vector<std::string> _origin_prefixes;
+    /** Prefixes of the destination ICAO code; any one must match */
+    std::vector<std::string> _destination_prefixes;
+    /** Time window that the flight must be in the air during */
+    boost::posix_time::ptime _window_start;
+    boost::posix_time::ptime _window_end;
+    bool _has_window;
+    /** Longitudes that the track must cross, degrees */
+    std::vector<double> _crossed_longitudes;
+
+public:
+    /** Creates a filter that accepts all flights */
+    FlightFilter();
+
+    /**
+     * Returns a filter that accepts flights between North America and Europe,
+     * in either direction
+     *
+     * This is the same classification as filter_flights/filter_flights.rb.
+     */
+    static FlightFilter transatlantic();
+
+    /** Requires the origin airport to be in a region */
+    FlightFilter& origin_region(Region region);
+    /** Requires the destination airport to be in a region */
+    FlightFilter& destination_region(Region region);
+    /** Requires the flight to go from one region to the other, in either direction */
+    FlightFilter& between_regions(Region first, Region second);
+    /**
+     * Requires the origin ICAO code to start with a prefix
+     *
+     * If this is called more than once, a flight matches if its origin starts
+     * with any of the prefixes.
+     */
+    FlightFilter& origin_prefix(const std::string& prefix);
+    /** Like origin_prefix(), for the destination */
+    FlightFilter& destination_prefix(const std::string& prefix);
+    /** Requires the flight to be in the air at some time between start and end, inclusive */
+    FlightFilter& airborne_between(boost::posix_time::ptime start, boost::posix_time::ptime end);
+    /** Requires the track of the flight to cross a line of longitude */
+    FlightFilter& crosses_longitude(double longitude);
+
+    /**
+     * Returns true if a flight with the provided origin and destination airport
+     * codes could match this filter
+     *
+     * Only the conditions on airports and regions are checked.
+     */
+    bool matches_airports(const std::string& origin, const std::string& destination) const;
+
+    /**
+     * Returns true if a flight matches this filter
+     *
+     * The flight must still have its points if this filter has conditions on
+     * crossing longitudes.
+     */
+    bool matches(const Flight& flight) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "trajectory.h"
+#include <cmath>
+
+namespace flightkml {
+
+namespace {
+
+std::int32_t degrees_to_units(double degrees) {
+    return static_cast<std::int32_t>(std::lround(degrees / Trajectory::DEGREES_PER_UNIT));
+}
+
+}
+
+constexpr double Trajectory::DEGREES_PER_UNIT;
+
+Trajectory::Trajectory() :
+    _start()
+{
+}
+
+void Trajectory::push_back(const Point& point) {
+    if (empty()) {
+        _start = point.time();
+    }
+    const auto since_start = point.time() - _start;
+    _seconds.push_back(static_cast<std::int32_t>(since_start.total_seconds()));
+    _latitude.push_back(degrees_to_units(point.latitude()));
+    _longitude.push_back(degrees_to_units(point.longitude()));
+    _altitude.push_back(static_cast<float>(point.altitude()));
+}
+
+void Trajectory::reserve(std::size_t capacity) {
+    _seconds.reserve(capacity);
+    _latitude.reserve(capacity);
+    _longitude.reserve(capacity);
+    _altitude.reserve(capacity);
+}
+
+void Trajectory::release() {
+    // swap() with empty vectors frees the memory, unlike clear()
+    std::vector<std::int32_t>().swap(_seconds);
+    std::vector<std::int32_t>().swap(_latitude);
+    std::vector<std::int32_t>().swap(_longitude);
+    std::vector<float>().swap(_altitude);
+}
+
+std::size_t Trajectory::memory_usage() const {
+    return _seconds.capacity() * sizeof(std::int32_t)
+        + _latitude.capacity() * sizeof(std::int32_t)
+        + _longitude.capacity() * sizeof(std::int32_t)
+        + _altitude.capacity() * sizeof(float);
+}
+
+}
@@ -0,0 +1,152 @@
+#ifndef FLIGHTKML_TRAJECTORY_H
+#define FLIGHTKML_TRAJECTORY_H
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "point.h"
+
+namespace flightkml {
+
+/**
+ * A compact sequence of points
+ *
+ * Points are stored in separate columns:
+ * * Time, whole seconds after the time of the first point, 32 bits
+ * * Latitude and longitude, units of 10^-7 degrees (about 1 cm), 32 bits each
+ * * Altitude, meters, 32-bit float
+ *
+ * This uses 16 bytes per point, half the size of a Point. Points are
+ * converted back to Point objects when accessed, so a Trajectory can be
+ * used like a container of Points.
+ */
+class Trajectory {
+public:
+    /** An iterator that yields Point values */
+    class const_iterator {
+    private:
+        const Trajectory* _trajectory;
+        std::size_t _index;
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Point value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Point* pointer;
+        typedef Point reference;
+
+        const_iterator(const Trajectory* trajectory, std::size_t index) :
+            _trajectory(trajectory),
+            _index(index)
+        {
+        }
+        inline Point operator * () const {
+            return (*_trajectory)[_index];
+        }
+        inline const_iterator& operator ++ () {
+            _index++;
+            return *this;
+        }
+        inline const_iterator operator ++ (int) {
+            const auto old = *this;
+            _index++;
+            return old;
+        }
+        inline bool operator == (const const_iterator& other) const {
+            return _index == other._index && _trajectory == other._trajectory;
+        }
+        inline bool operator != (const const_iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    /** Creates an empty trajectory */
+    Trajectory();
+
+    /**
+     * Appends a point
+     *
+     * The time of the point is rounded down to a whole number of seconds
+     * after the time of the first point.
+     */
+    void push_back(const Point& point);
+    void reserve(std::size_t capacity);
+
+    inline std::size_t size() const {
+        return _seconds.size();
+    }
+    inline bool empty() const {
+        return _seconds.empty();
+    }
+
+    /** Returns the point at the provided index, which must be less than size() */
+    inline Point operator [] (std::size_t index) const {
+        return Point(time(index), latitude(index), longitude(index), altitude(index));
+    }
+    /** Returns the first point. The trajectory must not be empty. */
+    inline Point front() const {
+        return (*this)[0];
+    }
+    /** Returns the last point. The trajectory must not be empty. */
+    inline Point back() const {
+        return (*this)[size() - 1];
+    }
+
+    inline const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+    inline const_iterator end() const {
+        return const_iterator(this, size());
+    }
+
+    // Access to individual columns, without constructing Points
+
+    /** Returns the time of the first point, or a default-constructed ptime if empty */
+    inline boost::posix_time::ptime start_time() const {
+        return _start;
+    }
+    /** Returns the time of a point, in seconds after start_time() */
+    inline std::int32_t seconds(std::size_t index) const {
+        return _seconds[index];
+    }
+    inline boost::posix_time::ptime time(std::size_t index) const {
+        return _start + boost::posix_time::seconds(_seconds[index]);
+    }
+    inline double latitude(std::size_t index) const {
+        return static_cast<double>(_latitude[index]) * DEGREES_PER_UNIT;
+    }
+    inline double longitude(std::size_t index) const {
+        return static_cast<double>(_longitude[index]) * DEGREES_PER_UNIT;
+    }
+    inline double altitude(std::size_t index) const {
+        return static_cast<double>(_altitude[index]);
+    }
+
+    /** Removes all points and frees their memory */
+    void release();
+
+    /** Returns the approximate number of bytes of memory used for points */
+    std::size_t memory_usage() const;
+
+    /** Size of one unit of latitude or longitude, degrees */
+    static constexpr double DEGREES_PER_UNIT = 1e-7;
+
+private:
+    friend class Flight;
+
+    /** Time of the first point */
+    boost::posix_time::ptime _start;
+    /** Seconds after _start */
+    std::vector<std::int32_t> _seconds;
+    /** Latitude, units of DEGREES_PER_UNIT */
+    std::vector<std::int32_t> _latitude;
+    /** Longitude, units of DEGREES_PER_UNIT */
+    std::vector<std::int32_t> _longitude;
+    /** Altitude above mean sea level, meters */
+    std::vector<float> _altitude;
+};
+
+}
+
+#endif
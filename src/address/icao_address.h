@@ -1,6 +1,7 @@
 #ifndef ICAO_ADDRESS_H
 #define ICAO_ADDRESS_H
 #include <cstdint>
+#include <functional>
 #include <ostream>
 #include <ns3/address.h>
 
@@ -79,4 +80,14 @@ private:
     static std::uint8_t GetType();
 };
 
+namespace std {
+/** Hashes ICAO addresses for unordered containers */
+template <>
+struct hash<IcaoAddress> {
+    inline std::size_t operator () (const IcaoAddress& address) const {
+        return std::hash<std::uint32_t>()(address.Value());
+    }
+};
+}
+
 #endif
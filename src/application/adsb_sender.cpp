@@ -19,6 +19,12 @@ void AdsBSender::SetSendOperation(send_operation operation) {
     _send_operation = operation;
 }
 
+void AdsBSender::Stop() {
+    NS_LOG_FUNCTION(this);
+    StopApplication();
+    _send_operation = send_operation();
+}
+
 void AdsBSender::StartApplication() {
     NS_LOG_FUNCTION(this);
     _send_event = ns3::Simulator::ScheduleNow(&AdsBSender::SendMessage, this);
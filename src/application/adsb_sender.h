@@ -21,6 +21,12 @@ public:
 
     void SetSendOperation(send_operation operation);
 
+    /**
+     * Stops sending and releases the send operation, for a node that has
+     * left the simulation
+     */
+    void Stop();
+
     static ns3::TypeId GetTypeId();
 
 private:
@@ -2,6 +2,7 @@
 #include <ns3/log.h>
 #include <ns3/simulator.h>
 #include <limits>
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE("Ether");
 
@@ -27,6 +28,12 @@ void Ether::AddDevice(ns3::Ptr<MeshNetDevice> device) {
     _devices.push_back(device);
 }
 
+void Ether::RemoveDevice(ns3::Ptr<MeshNetDevice> device) {
+    NS_LOG_FUNCTION(this << device);
+    device->SetSendCallback(MeshNetDevice::send_callback());
+    _devices.erase(std::remove(_devices.begin(), _devices.end(), device), _devices.end());
+}
+
 void Ether::OnSend(const MeshNetDevice* sender, const ns3::Vector& position, ns3::Packet packet) {
     NS_LOG_FUNCTION(this << position << packet);
     // Find all devices in range
@@ -42,6 +42,11 @@ public:
     double GetRange() const;
 
     void AddDevice(ns3::Ptr<MeshNetDevice> device);
+    /**
+     * Removes a device from this medium. The device will no longer send
+     * or receive messages.
+     */
+    void RemoveDevice(ns3::Ptr<MeshNetDevice> device);
 
 private:
     /**
@@ -1,36 +1,54 @@
 #include "flight_group.h"
+#include <cassert>
 
 FlightGroup::FlightGroup(std::vector<flightkml::Flight>&& flights) :
-    _flights(flights)
+    _flights(std::move(flights)),
+    _index(_flights)
 {
 }
 
 boost::posix_time::ptime FlightGroup::first_departure_time() const {
-    auto first = boost::posix_time::ptime(boost::posix_time::pos_infin);
-    for (const auto& flight : _flights) {
-        const auto departure = flight.departure_time();
-        if (!departure.is_special() && departure < first) {
-            first = departure;
-        }
+    return _index.first_departure_time();
+}
+
+boost::posix_time::ptime FlightGroup::last_arrival_time() const {
+    return _index.last_arrival_time();
+}
+
+std::vector<std::size_t> FlightGroup::airborne(boost::posix_time::ptime start, boost::posix_time::ptime stop) const {
+    return _index.airborne(start, stop);
+}
+
+std::vector<std::size_t> FlightGroup::within(const BoundingBox& box) const {
+    return _index.within(box);
+}
+
+std::vector<std::size_t> FlightGroup::airborne_within(boost::posix_time::ptime start, boost::posix_time::ptime stop, const BoundingBox& box) const {
+    return _index.airborne_within(start, stop, box);
+}
+
+void FlightGroup::retain(const std::vector<std::size_t>& indices) {
+    std::vector<flightkml::Flight> retained;
+    retained.reserve(indices.size());
+    for (const auto index : indices) {
+        assert(index < _flights.size());
+        retained.push_back(std::move(_flights[index]));
     }
-    if (first.is_special()) {
-        return boost::posix_time::ptime();
-    } else {
-        return first;
+    _flights = std::move(retained);
+    // The points may have been released, so the index is not built again
+    _index.retain(indices);
+}
+
+void FlightGroup::release_points() {
+    for (auto& flight : _flights) {
+        flight.release_points();
     }
 }
 
-boost::posix_time::ptime FlightGroup::last_arrival_time() const {
-    auto last = boost::posix_time::ptime(boost::posix_time::neg_infin);
+std::size_t FlightGroup::point_memory_usage() const {
+    std::size_t usage = 0;
     for (const auto& flight : _flights) {
-        const auto arrival = flight.arrival_time();
-        if (!arrival.is_special() && arrival > last) {
-            last = arrival;
-        }
-    }
-    if (last.is_special()) {
-        return boost::posix_time::ptime();
-    } else {
-        return last;
+        usage += flight.points().memory_usage();
     }
+    return usage;
 }
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <flightkml/flight.h>
+#include "flight_index.h"
 
 /**
  * A group of flight paths
@@ -11,6 +12,8 @@ class FlightGroup {
 private:
     /** The flights */
     std::vector<flightkml::Flight> _flights;
+    /** Index of flight times and areas */
+    FlightIndex _index;
 public:
     FlightGroup(std::vector<flightkml::Flight>&& flights);
 
@@ -33,6 +36,45 @@ public:
      * default-constructed ptime
      */
     boost::posix_time::ptime last_arrival_time() const;
+
+    /**
+     * Returns the indices in flights() of flights that are in the air at any
+     * time between start and stop, inclusive, in ascending order
+     */
+    std::vector<std::size_t> airborne(boost::posix_time::ptime start, boost::posix_time::ptime stop) const;
+
+    /**
+     * Returns the indices in flights() of flights whose bounding boxes
+     * intersect the provided box, in ascending order
+     */
+    std::vector<std::size_t> within(const BoundingBox& box) const;
+
+    /**
+     * Returns the indices in flights() of flights that are in the air between
+     * start and stop and whose bounding boxes intersect the provided box,
+     * in ascending order
+     */
+    std::vector<std::size_t> airborne_within(boost::posix_time::ptime start, boost::posix_time::ptime stop, const BoundingBox& box) const;
+
+    /**
+     * Keeps only the flights with the provided indices in flights(), in
+     * ascending order, and updates the index
+     *
+     * The result of a query can be passed here to select flights. This can
+     * also be called after release_points().
+     */
+    void retain(const std::vector<std::size_t>& indices);
+
+    /**
+     * Frees the memory used for the points of all flights
+     *
+     * This can be called after the points have been copied into mobility
+     * models. Departure and arrival times and the index remain available.
+     */
+    void release_points();
+
+    /** Returns the approximate number of bytes used for points of all flights */
+    std::size_t point_memory_usage() const;
 };
 
 #endif
@@ -0,0 +1,153 @@
+#include "flight_index.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace bgi = boost::geometry::index;
+using boost::posix_time::ptime;
+
+FlightIndex::FlightIndex() :
+    _first_departure(),
+    _last_arrival()
+{
+}
+
+FlightIndex::FlightIndex(const std::vector<flightkml::Flight>& flights) :
+    _first_departure(),
+    _last_arrival()
+{
+    std::vector<rtree_value> boxes;
+    for (std::size_t i = 0; i < flights.size(); i++) {
+        const auto& flight = flights[i];
+        const auto& points = flight.points();
+        if (points.empty() || flight.departure_time().is_special() || flight.arrival_time().is_special()) {
+            continue;
+        }
+        _intervals.push_back(Interval { flight.departure_time(), flight.arrival_time(), i });
+
+        auto box = BoundingBox { points.latitude(0), points.longitude(0), points.latitude(0), points.longitude(0) };
+        for (std::size_t j = 1; j < points.size(); j++) {
+            box.min_latitude = std::min(box.min_latitude, points.latitude(j));
+            box.max_latitude = std::max(box.max_latitude, points.latitude(j));
+            box.min_longitude = std::min(box.min_longitude, points.longitude(j));
+            box.max_longitude = std::max(box.max_longitude, points.longitude(j));
+        }
+        boxes.push_back(std::make_pair(ToGeoBox(box), i));
+    }
+    // The range constructor uses a packing algorithm, which makes a better
+    // tree than inserting one at a time
+    _boxes = decltype(_boxes)(boxes.begin(), boxes.end());
+
+    std::sort(_intervals.begin(), _intervals.end(), [](const Interval& i1, const Interval& i2) {
+        return i1.departure < i2.departure;
+    });
+    BuildIntervalTree();
+}
+
+void FlightIndex::retain(const std::vector<std::size_t>& indices) {
+    assert(std::is_sorted(indices.begin(), indices.end()));
+    // Finds the new index of a flight, if it is kept
+    const auto renumber = [&indices](std::size_t* flight) {
+        const auto in_indices = std::lower_bound(indices.begin(), indices.end(), *flight);
+        if (in_indices == indices.end() || *in_indices != *flight) {
+            return false;
+        }
+        *flight = static_cast<std::size_t>(in_indices - indices.begin());
+        return true;
+    };
+
+    // Removing intervals keeps them sorted by departure time
+    std::vector<Interval> intervals;
+    intervals.reserve(std::min(_intervals.size(), indices.size()));
+    for (auto interval : _intervals) {
+        if (renumber(&interval.flight)) {
+            intervals.push_back(interval);
+        }
+    }
+    _intervals = std::move(intervals);
+    _first_departure = ptime();
+    _last_arrival = ptime();
+    BuildIntervalTree();
+
+    std::vector<rtree_value> all_boxes;
+    _boxes.query(bgi::satisfies([](const rtree_value&) { return true; }), std::back_inserter(all_boxes));
+    std::vector<rtree_value> boxes;
+    boxes.reserve(std::min(all_boxes.size(), indices.size()));
+    for (auto value : all_boxes) {
+        if (renumber(&value.second)) {
+            boxes.push_back(value);
+        }
+    }
+    _boxes = decltype(_boxes)(boxes.begin(), boxes.end());
+}
+
+void FlightIndex::BuildIntervalTree() {
+    _max_arrival.assign(_intervals.size(), ptime());
+    if (!_intervals.empty()) {
+        _first_departure = _intervals.front().departure;
+        _last_arrival = BuildMaxArrival(0, _intervals.size());
+    }
+}
+
+ptime FlightIndex::BuildMaxArrival(std::size_t begin, std::size_t end) {
+    const auto middle = begin + (end - begin) / 2;
+    auto max_arrival = _intervals[middle].arrival;
+    if (begin < middle) {
+        max_arrival = std::max(max_arrival, BuildMaxArrival(begin, middle));
+    }
+    if (middle + 1 < end) {
+        max_arrival = std::max(max_arrival, BuildMaxArrival(middle + 1, end));
+    }
+    _max_arrival[middle] = max_arrival;
+    return max_arrival;
+}
+
+void FlightIndex::QueryIntervals(std::size_t begin, std::size_t end, ptime start, ptime stop, std::vector<std::size_t>* result) const {
+    if (begin >= end) {
+        return;
+    }
+    const auto middle = begin + (end - begin) / 2;
+    // Nothing in this subtree arrives after start
+    if (_max_arrival[middle] < start) {
+        return;
+    }
+    QueryIntervals(begin, middle, start, stop, result);
+    // Everything to the right departs after the middle element
+    if (_intervals[middle].departure <= stop) {
+        if (_intervals[middle].arrival >= start) {
+            result->push_back(_intervals[middle].flight);
+        }
+        QueryIntervals(middle + 1, end, start, stop, result);
+    }
+}
+
+FlightIndex::geo_box FlightIndex::ToGeoBox(const BoundingBox& box) {
+    return geo_box(geo_point(box.min_longitude, box.min_latitude), geo_point(box.max_longitude, box.max_latitude));
+}
+
+std::vector<std::size_t> FlightIndex::airborne(ptime start, ptime stop) const {
+    std::vector<std::size_t> result;
+    QueryIntervals(0, _intervals.size(), start, stop, &result);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<std::size_t> FlightIndex::within(const BoundingBox& box) const {
+    std::vector<rtree_value> values;
+    _boxes.query(bgi::intersects(ToGeoBox(box)), std::back_inserter(values));
+    std::vector<std::size_t> result;
+    result.reserve(values.size());
+    for (const auto& value : values) {
+        result.push_back(value.second);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<std::size_t> FlightIndex::airborne_within(ptime start, ptime stop, const BoundingBox& box) const {
+    const auto in_time = airborne(start, stop);
+    const auto in_box = within(box);
+    std::vector<std::size_t> result;
+    std::set_intersection(in_time.begin(), in_time.end(), in_box.begin(), in_box.end(), std::back_inserter(result));
+    return result;
+}
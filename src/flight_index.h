@@ -0,0 +1,130 @@
+#ifndef FLIGHT_INDEX_H
+#define FLIGHT_INDEX_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/geometry/geometries/box.hpp>
+#include <boost/geometry/geometries/point.hpp>
+#include <boost/geometry/index/rtree.hpp>
+#include <flightkml/flight.h>
+
+/**
+ * A latitude/longitude bounding box
+ *
+ * Boxes do not wrap around at 180 degrees longitude.
+ */
+struct BoundingBox {
+    /** Minimum latitude, degrees */
+    double min_latitude;
+    /** Minimum longitude, degrees */
+    double min_longitude;
+    /** Maximum latitude, degrees */
+    double max_latitude;
+    /** Maximum longitude, degrees */
+    double max_longitude;
+};
+
+/**
+ * An index of the times and areas of a set of flights
+ *
+ * Flights are identified by their indices in the vector that the index was
+ * built from. Flights with no points are not included.
+ *
+ * Times are indexed with an interval tree, and bounding boxes with an
+ * R-tree, so queries do not need to look at every flight.
+ */
+class FlightIndex {
+private:
+    typedef boost::posix_time::ptime ptime;
+    typedef boost::geometry::model::point<double, 2, boost::geometry::cs::cartesian> geo_point;
+    typedef boost::geometry::model::box<geo_point> geo_box;
+    typedef std::pair<geo_box, std::size_t> rtree_value;
+
+    /** The time interval of a flight */
+    struct Interval {
+        ptime departure;
+        ptime arrival;
+        std::size_t flight;
+    };
+
+    /**
+     * Flight intervals sorted by departure time
+     *
+     * This is an implicit balanced tree: the root of each range is its
+     * middle element.
+     */
+    std::vector<Interval> _intervals;
+    /**
+     * For each element in _intervals, the latest arrival time in the
+     * subtree rooted at that element
+     */
+    std::vector<ptime> _max_arrival;
+    /** Bounding box of each flight, longitude on the x axis */
+    boost::geometry::index::rtree<rtree_value, boost::geometry::index::quadratic<16>> _boxes;
+
+    ptime _first_departure;
+    ptime _last_arrival;
+
+    /** Sets _max_arrival and the first and last times from _intervals */
+    void BuildIntervalTree();
+    ptime BuildMaxArrival(std::size_t begin, std::size_t end);
+    void QueryIntervals(std::size_t begin, std::size_t end, ptime start, ptime stop, std::vector<std::size_t>* result) const;
+
+    static geo_box ToGeoBox(const BoundingBox& box);
+
+public:
+    /** Creates an empty index */
+    FlightIndex();
+    /** Creates an index of the provided flights */
+    explicit FlightIndex(const std::vector<flightkml::Flight>& flights);
+
+    /**
+     * Returns the departure time of the flight that departs first, or a
+     * default-constructed ptime if no flights have points
+     */
+    inline ptime first_departure_time() const {
+        return _first_departure;
+    }
+    /**
+     * Returns the arrival time of the flight that arrives last, or a
+     * default-constructed ptime if no flights have points
+     */
+    inline ptime last_arrival_time() const {
+        return _last_arrival;
+    }
+
+    /**
+     * Returns the indices of flights that are in the air at any time
+     * between start and stop, inclusive, in ascending order
+     */
+    std::vector<std::size_t> airborne(ptime start, ptime stop) const;
+
+    /**
+     * Returns the indices of flights with at least one point inside or near
+     * the provided box, in ascending order
+     *
+     * Flights are matched by their bounding boxes, so a flight may be returned
+     * even if none of its points are inside the box.
+     */
+    std::vector<std::size_t> within(const BoundingBox& box) const;
+
+    /**
+     * Returns the indices of flights that are in the air between start and
+     * stop and whose bounding boxes intersect the provided box, in ascending
+     * order
+     */
+    std::vector<std::size_t> airborne_within(ptime start, ptime stop, const BoundingBox& box) const;
+
+    /**
+     * Keeps only the flights with the provided indices, in ascending order,
+     * and renumbers them to their positions in indices
+     *
+     * This uses the times and bounding boxes already in the index, so it
+     * does not need the points of the flights.
+     */
+    void retain(const std::vector<std::size_t>& indices);
+};
+
+#endif
@@ -1,6 +1,9 @@
 #include "flight_load.h"
+#include <flightkml/flight_cache.h>
 #include <boost/filesystem.hpp>
+#include <iostream>
 using flightkml::Flight;
+using flightkml::FlightCache;
 
 FlightGroup load_flights(const std::string& directory) {
     auto flights = std::vector<Flight>();
@@ -13,3 +16,23 @@ FlightGroup load_flights(const std::string& directory) {
     }
     return FlightGroup(std::move(flights));
 }
+
+FlightGroup load_flights(const std::string& directory, const std::string& cache_directory, const flightkml::FlightFilter& filter) {
+    auto flights = std::vector<Flight>();
+    FlightCache cache(cache_directory);
+
+    for (const auto& entry : boost::filesystem::directory_iterator(directory)) {
+        if (boost::filesystem::is_regular_file(entry)) {
+            auto flight = cache.read_if(entry.path().native(), filter);
+            if (flight) {
+                flights.push_back(std::move(*flight));
+            }
+        }
+    }
+    cache.save();
+    std::cerr << "Loaded " << flights.size() << " flights, "
+        << cache.parsed_count() << " parsed from KML and "
+        << cache.cached_count() << " from cache, "
+        << cache.rejected_count() << " rejected by filter\n";
+    return FlightGroup(std::move(flights));
+}
@@ -1,6 +1,7 @@
 #ifndef FLIGHT_LOAD_H
 #define FLIGHT_LOAD_H
 #include <string>
+#include <flightkml/flight_filter.h>
 #include "flight_group.h"
 
 /**
@@ -9,4 +10,15 @@
  */
 FlightGroup load_flights(const std::string& directory);
 
+/**
+ * Loads flights from all KML files in the directory at the provided path
+ * and returns them as a group
+ *
+ * Flights are read through a flightkml::FlightCache in cache_directory, so
+ * only KML files that are new or have changed since the last load are parsed.
+ * Flights that do not match the filter are not included.
+ */
+FlightGroup load_flights(const std::string& directory, const std::string& cache_directory,
+    const flightkml::FlightFilter& filter = flightkml::FlightFilter());
+
 #endif
@@ -0,0 +1,94 @@
+#include "flight_stream.h"
+#include <algorithm>
+#include <iostream>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <ns3/simulator.h>
+#include <ns3/log.h>
+
+NS_LOG_COMPONENT_DEFINE("FlightStream");
+
+FlightStream::FlightStream(const std::string& directory, const std::string& cache_directory, const flightkml::FlightFilter& filter) :
+    _entries(),
+    _cache(cache_directory),
+    _epoch(),
+    _lead_time(ns3::Minutes(1)),
+    _next(0),
+    _departure_callback(),
+    _arrival_callback()
+{
+    for (const auto& entry : boost::filesystem::directory_iterator(directory)) {
+        if (boost::filesystem::is_regular_file(entry)) {
+            const auto path = entry.path().native();
+            // Points are freed when the flight goes out of scope
+            const auto flight = _cache.read_if(path, filter);
+            if (flight && !flight->points().empty()) {
+                _entries.push_back(Entry { path, flight->departure_time(), flight->arrival_time() });
+            }
+        }
+    }
+    _cache.save();
+    std::sort(_entries.begin(), _entries.end(), [](const Entry& a, const Entry& b) {
+        return a.departure < b.departure;
+    });
+    if (!_entries.empty()) {
+        _epoch = _entries.front().departure;
+    }
+    std::cerr << "Found " << _entries.size() << " flights, "
+        << _cache.parsed_count() << " parsed from KML and "
+        << _cache.cached_count() << " from cache, "
+        << _cache.rejected_count() << " rejected by filter\n";
+}
+
+boost::posix_time::ptime FlightStream::FirstDepartureTime() const {
+    return _epoch;
+}
+
+void FlightStream::SetLeadTime(ns3::Time lead_time) {
+    _lead_time = lead_time;
+}
+
+void FlightStream::SetDepartureCallback(departure_callback callback) {
+    _departure_callback = callback;
+}
+
+void FlightStream::SetArrivalCallback(arrival_callback callback) {
+    _arrival_callback = callback;
+}
+
+void FlightStream::Start() {
+    _next = 0;
+    ns3::Simulator::Schedule(ns3::Time(), &FlightStream::DepartNext, this);
+}
+
+void FlightStream::DepartNext() {
+    const auto now = ns3::Simulator::Now();
+    while (_next != _entries.size() && ToSimulationTime(_entries[_next].departure) - _lead_time <= now) {
+        const auto index = _next;
+        _next++;
+        const auto& entry = _entries[index];
+        NS_LOG_INFO("Flight " << index << " departs at " << entry.departure);
+        {
+            const auto flight = _cache.read(entry.path);
+            if (_departure_callback) {
+                _departure_callback(index, flight);
+            }
+        }
+        ns3::Simulator::Schedule(ToSimulationTime(entry.arrival) - now, &FlightStream::Arrive, this, index);
+    }
+    if (_next != _entries.size()) {
+        const auto next_time = ToSimulationTime(_entries[_next].departure) - _lead_time;
+        ns3::Simulator::Schedule(next_time - now, &FlightStream::DepartNext, this);
+    }
+}
+
+void FlightStream::Arrive(std::size_t index) {
+    NS_LOG_INFO("Flight " << index << " arrives at " << _entries[index].arrival);
+    if (_arrival_callback) {
+        _arrival_callback(index);
+    }
+}
+
+ns3::Time FlightStream::ToSimulationTime(boost::posix_time::ptime time) const {
+    return ns3::MicroSeconds((time - _epoch).total_microseconds());
+}
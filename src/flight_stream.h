@@ -0,0 +1,106 @@
+#ifndef FLIGHT_STREAM_H
+#define FLIGHT_STREAM_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <ns3/nstime.h>
+#include <flightkml/flight.h>
+#include <flightkml/flight_cache.h>
+#include <flightkml/flight_filter.h>
+
+/**
+ * Provides flights to a simulation one at a time, in departure order,
+ * shortly before each one departs
+ *
+ * Only the departure and arrival times of each flight are kept in memory.
+ * When a flight is about to depart, it is read again from the flight cache
+ * and passed to the departure callback. After the callback returns, the
+ * points of the flight are freed. When the flight arrives, the arrival
+ * callback is called.
+ *
+ * Memory used for flights therefore follows the number of flights that are
+ * in the air at the same time, not the total number of flights.
+ */
+class FlightStream {
+public:
+    /**
+     * Called shortly before a flight departs, with the index of the flight
+     * in departure order and the flight
+     */
+    typedef std::function<void(std::size_t index, const flightkml::Flight& flight)> departure_callback;
+    /** Called when a flight arrives, with the index of the flight in departure order */
+    typedef std::function<void(std::size_t index)> arrival_callback;
+
+private:
+    /** Information about a flight that has not yet been read into memory */
+    struct Entry {
+        /** Path to the KML file */
+        std::string path;
+        /** Time of the first point */
+        boost::posix_time::ptime departure;
+        /** Time of the last point */
+        boost::posix_time::ptime arrival;
+    };
+
+    /** The flights, sorted by departure time */
+    std::vector<Entry> _entries;
+    /** The cache that flights are read from */
+    flightkml::FlightCache _cache;
+    /** The real-world time that corresponds to zero simulation time */
+    boost::posix_time::ptime _epoch;
+    /** How long before departure each flight is provided */
+    ns3::Time _lead_time;
+    /** Index in _entries of the next flight to provide */
+    std::size_t _next;
+
+    departure_callback _departure_callback;
+    arrival_callback _arrival_callback;
+
+    /** Provides all flights that depart within the lead time, and schedules the next call */
+    void DepartNext();
+    /** Calls the arrival callback for a flight */
+    void Arrive(std::size_t index);
+    /** Converts a real-world time into a simulation time */
+    ns3::Time ToSimulationTime(boost::posix_time::ptime time) const;
+
+public:
+    /**
+     * Finds the flights in all KML files in the directory at the provided path
+     *
+     * Flights are read through a flightkml::FlightCache in cache_directory
+     * to find their departure and arrival times, and the points are then
+     * discarded. Flights that do not match the filter or have no points
+     * are skipped.
+     */
+    FlightStream(const std::string& directory, const std::string& cache_directory,
+        const flightkml::FlightFilter& filter = flightkml::FlightFilter());
+
+    /** Returns the number of flights */
+    inline std::size_t size() const {
+        return _entries.size();
+    }
+
+    /**
+     * Returns the departure time of the flight that departs first, or
+     * a default-constructed ptime if there are no flights
+     */
+    boost::posix_time::ptime FirstDepartureTime() const;
+
+    /** Sets how long before departure each flight is provided. The default is one minute. */
+    void SetLeadTime(ns3::Time lead_time);
+
+    void SetDepartureCallback(departure_callback callback);
+    void SetArrivalCallback(arrival_callback callback);
+
+    /**
+     * Schedules the flights
+     *
+     * Zero simulation time corresponds to FirstDepartureTime().
+     */
+    void Start();
+};
+
+#endif
@@ -1,19 +1,32 @@
 
 #include <iostream>
 #include <cassert>
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <sys/resource.h>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "flight_load.h"
+#include "flight_stream.h"
 #include "flight_mobility.h"
 #include "address/icao_address.h"
 #include "device/mesh_net_device.h"
+#include "application/adsb_sender.h"
 #include "application/adsb_sender_helper.h"
 #include "ether/ether.h"
 #include "recorder/session_recorder.h"
 #include "packet_recorder/packet_recorder.h"
 
 #include "network/olsr/olsr.h"
+#include "network/olsr/routing_calc.h"
+#include "network/timer_wheel.h"
+#include "network/batch_runner.h"
 #include "network/dream/dream.h"
 
 #include <ns3/node-container.h>
@@ -22,52 +35,83 @@
 #include <ns3/geographic-positions.h>
 #include <ns3/log.h>
 #include <ns3/simulator.h>
+#include <ns3/command-line.h>
+#include <ns3/node-list.h>
 
 NS_LOG_COMPONENT_DEFINE("AircraftMeshSimulation");
 
 
 namespace {
 
-ns3::Ptr<NetworkProtocol> create_protocol() {
-    // return ns3::CreateObject<olsr::Olsr>();
+/** Network protocol settings */
+struct ProtocolOptions {
+    /** True to use OLSR, false to use DREAM */
+    bool olsr;
+    /** If true, OLSR Hello messages use the compact format */
+    bool compact_hello;
+    /** OLSR fisheye TTL scopes, or empty to disable fisheye topology control */
+    std::vector<std::uint8_t> fisheye_scopes;
+    /** OLSR link lifetime metric transmission range in meters, or 0 to disable the metric */
+    double link_range;
+    /** If true, OLSR nodes only keep routes to neighbors and gateways */
+    bool gateway_routes_only;
+    /** OLSR cluster cell size in degrees, or 0 to disable clustered routing */
+    double cluster_cell_size;
+};
+
+ns3::Ptr<NetworkProtocol> create_protocol(const ProtocolOptions& options) {
+    if (options.olsr) {
+        auto olsr = ns3::CreateObject<olsr::Olsr>();
+        olsr->SetCompactHello(options.compact_hello);
+        olsr->SetFisheyeScopes(options.fisheye_scopes);
+        olsr->SetLinkLifetimeMetric(options.link_range);
+        olsr->SetGatewayRoutesOnly(options.gateway_routes_only);
+        olsr->SetClusterCellSize(options.cluster_cell_size);
+        return olsr;
+    }
     return ns3::CreateObject<dream::Dream>();
 }
 
 /**
- * Creates and configures aircraft nodes. Returns a container of them.
+ * Creates and configures a node for a flight
+ *
+ * @param epoch the real-world time that corresponds to zero simulation time
  */
-ns3::NodeContainer create_aircraft(const FlightGroup& flights) {
-    const auto first_departure = flights.first_departure_time();
-    NS_LOG_INFO("Read " << flights.flights().size() << " flights");
-    // Set up a node for each flight
-    ns3::NodeContainer nodes;
-    nodes.Create(flights.flights().size());
+ns3::Ptr<ns3::Node> create_aircraft_node(const flightkml::Flight& flight, const boost::posix_time::ptime& epoch, IcaoAddress address) {
+    auto node = ns3::CreateObject<ns3::Node>();
 
     // Set up mobility helper, which allocates a WaypointMobilityModel
-    // for each flight
     ns3::MobilityHelper mobility;
     mobility.SetMobilityModel("ns3::WaypointMobilityModel");
-    mobility.Install(nodes);
+    mobility.Install(node);
 
-    // Per-flight setup
-    for (std::size_t i = 0; i < flights.flights().size(); i++) {
-        auto node = nodes.Get(i);
+    // Positions
+    auto mobility_model = node->GetObject<ns3::WaypointMobilityModel>();
+    assert(!!mobility_model);
+    // Fill in waypoints
+    fill_flight_waypoints(flight, epoch, ns3::PeekPointer(mobility_model));
+
+    // Network device
+    const ns3::Ptr<MeshNetDevice> device = ns3::CreateObject<MeshNetDevice>();
+    device->SetAddress(address);
+    device->SetMobilityModel(mobility_model);
+    node->AggregateObject(device);
 
-        // Positions
-        const auto& flight = flights.flights()[i];
-        auto mobility_model = node->GetObject<ns3::WaypointMobilityModel>();
-        assert(!!mobility_model);
-        // Fill in waypoints
-        fill_flight_waypoints(flight, first_departure, ns3::PeekPointer(mobility_model));
+    return node;
+}
 
-        // Address and network device
+/**
+ * Creates and configures aircraft nodes. Returns a container of them.
+ */
+ns3::NodeContainer create_aircraft(const FlightGroup& flights) {
+    const auto first_departure = flights.first_departure_time();
+    NS_LOG_INFO("Read " << flights.flights().size() << " flights");
+    // Set up a node for each flight
+    ns3::NodeContainer nodes;
+    for (std::size_t i = 0; i < flights.flights().size(); i++) {
         const IcaoAddress address(static_cast<std::uint32_t>(i));
         NS_LOG_INFO("Flight " << i << ": address " << address);
-        const ns3::Ptr<MeshNetDevice> device = ns3::CreateObject<MeshNetDevice>();
-        device->SetAddress(address);
-        device->SetMobilityModel(mobility_model);
-        node->AggregateObject(device);
-
+        nodes.Add(create_aircraft_node(flights.flights()[i], first_departure, address));
     }
 
     return nodes;
@@ -108,13 +152,212 @@ ns3::NodeContainer create_ground_stations() {
     return nodes;
 }
 
+/**
+ * Parses an area of the form min_latitude,min_longitude,max_latitude,max_longitude
+ *
+ * Returns false if the text is not in that form.
+ */
+bool parse_area(const std::string& text, BoundingBox* box) {
+    std::istringstream stream(text);
+    char comma1, comma2, comma3;
+    stream >> box->min_latitude >> comma1 >> box->min_longitude >> comma2
+        >> box->max_latitude >> comma3 >> box->max_longitude;
+    return stream && stream.eof() && comma1 == ',' && comma2 == ',' && comma3 == ',';
+}
+
+/**
+ * Parses a time in the format YYYY-MM-DDTHH:MM:SS
+ *
+ * Returns true if the text is valid.
+ */
+bool parse_time(const std::string& text, boost::posix_time::ptime* time) {
+    try {
+        *time = boost::posix_time::from_iso_extended_string(text);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return !time->is_special();
+}
+
+/**
+ * Parses fisheye TTL scopes in the format scope1,scope2,...
+ *
+ * Each scope must be from 1 to 255 and larger than the previous one.
+ * Returns true if the text is valid.
+ */
+bool parse_fisheye_scopes(const std::string& text, std::vector<std::uint8_t>* scopes) {
+    std::istringstream stream(text);
+    scopes->clear();
+    while (true) {
+        unsigned int scope;
+        stream >> scope;
+        if (!stream || scope == 0 || scope > 255 || (!scopes->empty() && scope <= scopes->back())) {
+            return false;
+        }
+        scopes->push_back(static_cast<std::uint8_t>(scope));
+        if (stream.eof()) {
+            return true;
+        }
+        char comma;
+        stream >> comma;
+        if (!stream || comma != ',') {
+            return false;
+        }
+    }
+}
+
+/** Returns the peak resident memory of this process in KiB, or 0 if it is not known */
+long peak_memory_kib() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // Linux reports KiB
+    return usage.ru_maxrss;
+}
+
+/** Random timing of protocol timers */
+struct TimerJitter {
+    /** Maximum random delay before the first call of each timer */
+    ns3::Time phase;
+    /** Maximum random delay of each timer call */
+    ns3::Time jitter;
+};
+
+/**
+ * Adds the network device of a node to the ether and sets up a network
+ * protocol for the node
+ *
+ * The protocol uses the random variable stream with the same number as the
+ * node ID, so its timing does not depend on the order of node creation.
+ */
+void connect_node(ns3::Ptr<ns3::Node> node, Ether& ether, ns3::Ptr<PacketRecorder> packet_recorder,
+    const ProtocolOptions& protocol_options, const TimerJitter& timer_jitter) {
+    auto net_device = node->GetObject<MeshNetDevice>();
+    assert(net_device);
+    ether.AddDevice(net_device);
+    auto protocol = create_protocol(protocol_options);
+    protocol->SetTimerJitter(timer_jitter.phase, timer_jitter.jitter);
+    protocol->AssignStreams(node->GetId());
+    protocol->Start();
+    protocol->SetNetDevice(net_device);
+    protocol->SetPacketRecorder(packet_recorder);
+    node->AggregateObject(protocol);
+}
+
 }
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        std::cerr << "Usage: simulation kml-folder-path\n";
+    // Options
+    bool transatlantic = false;
+    bool streaming = false;
+    std::string origin_prefix;
+    std::string destination_prefix;
+    std::string window_start;
+    std::string window_end;
+    std::string area;
+    std::string protocol = "dream";
+    bool compact_hello = false;
+    std::string fisheye_scopes;
+    double link_range = 0;
+    bool gateway_routes_only = false;
+    double cluster_cell_size = 0;
+    double timer_phase = 0;
+    double timer_jitter = 0;
+    unsigned int route_threads = 0;
+    ns3::CommandLine command_line;
+    command_line.AddValue("transatlantic", "Only load flights between North America and Europe", transatlantic);
+    command_line.AddValue("origin", "Only load flights with origin airport codes starting with this prefix", origin_prefix);
+    command_line.AddValue("destination", "Only load flights with destination airport codes starting with this prefix", destination_prefix);
+    command_line.AddValue("streaming", "Read each flight shortly before it departs instead of loading all flights at the start", streaming);
+    command_line.AddValue("window-start", "Only load flights in the air at or after this time, YYYY-MM-DDTHH:MM:SS", window_start);
+    command_line.AddValue("window-end", "Only load flights in the air at or before this time, YYYY-MM-DDTHH:MM:SS", window_end);
+    command_line.AddValue("area", "Only load flights whose tracks pass near this area, "
+        "min_latitude,min_longitude,max_latitude,max_longitude in degrees (not with --streaming)", area);
+    command_line.AddValue("protocol", "Network protocol, olsr or dream", protocol);
+    command_line.AddValue("compact-hello", "Send OLSR Hello messages in the compact, delta-encoded format", compact_hello);
+    command_line.AddValue("fisheye-scopes", "OLSR fisheye topology control TTL scopes in increasing order, "
+        "scope1,scope2,... (for example 2,4,8)", fisheye_scopes);
+    command_line.AddValue("link-range", "Transmission range for the OLSR link lifetime metric, meters, "
+        "or 0 to disable the metric", link_range);
+    command_line.AddValue("gateway-routes-only", "OLSR nodes only keep routes to neighbors and gateways, "
+        "and reach other destinations through the nearest gateway", gateway_routes_only);
+    command_line.AddValue("cluster-cell-size", "Cell size for OLSR two-level clustered routing, degrees, "
+        "or 0 to disable clustering", cluster_cell_size);
+    command_line.AddValue("timer-phase", "Maximum random delay before the first message of each protocol timer, seconds "
+        "(default 0, no randomization)", timer_phase);
+    command_line.AddValue("timer-jitter", "Maximum random delay of each protocol timer message, seconds "
+        "(default 0, no randomization)", timer_jitter);
+    command_line.AddValue("route-threads", "Number of threads that calculate routes, or 0 for one per hardware thread. "
+        "Route calculations use one thread when they are logged.", route_threads);
+    command_line.Parse(argc, argv);
+    if (timer_phase < 0 || timer_jitter < 0) {
+        std::cerr << "Invalid timer phase or jitter\n";
+        return -1;
+    }
+    const TimerJitter jitter { ns3::Seconds(timer_phase), ns3::Seconds(timer_jitter) };
+    if (protocol != "olsr" && protocol != "dream") {
+        std::cerr << "Unknown protocol " << protocol << '\n';
+        return -1;
+    }
+    if (cluster_cell_size < 0) {
+        std::cerr << "Invalid cluster cell size " << cluster_cell_size << '\n';
         return -1;
     }
+    if (link_range < 0) {
+        std::cerr << "Invalid link range " << link_range << '\n';
+        return -1;
+    }
+    ProtocolOptions protocol_options { protocol == "olsr", compact_hello, {}, link_range, gateway_routes_only, cluster_cell_size };
+    if (!fisheye_scopes.empty() && !parse_fisheye_scopes(fisheye_scopes, &protocol_options.fisheye_scopes)) {
+        std::cerr << "Invalid fisheye scopes " << fisheye_scopes << '\n';
+        return -1;
+    }
+
+    // Positional arguments (CommandLine ignores arguments that do not start with -)
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() != 1 && positional.size() != 2) {
+        std::cerr << "Usage: simulation [--streaming] [--transatlantic] [--origin=prefix] [--destination=prefix] [--window-start=time] [--window-end=time] [--area=box] [--protocol=olsr|dream] [--compact-hello] [--fisheye-scopes=scopes] [--link-range=meters] [--gateway-routes-only] [--cluster-cell-size=degrees] [--timer-phase=seconds] [--timer-jitter=seconds] [--route-threads=count] kml-folder-path [cache-folder-path]\n";
+        return -1;
+    }
+    const auto kml_path = positional[0];
+    // Parsed flights are cached here, shared between datasets
+    const auto cache_path = positional.size() == 2 ? positional[1] : std::string(".flightkml_cache");
+
+    auto filter = transatlantic ? flightkml::FlightFilter::transatlantic() : flightkml::FlightFilter();
+    if (!origin_prefix.empty()) {
+        filter.origin_prefix(origin_prefix);
+    }
+    if (!destination_prefix.empty()) {
+        filter.destination_prefix(destination_prefix);
+    }
+    const auto has_window = !window_start.empty() || !window_end.empty();
+    auto start = boost::posix_time::ptime(boost::posix_time::neg_infin);
+    if (!window_start.empty() && !parse_time(window_start, &start)) {
+        std::cerr << "Invalid window start " << window_start << '\n';
+        return -1;
+    }
+    auto stop = boost::posix_time::ptime(boost::posix_time::pos_infin);
+    if (!window_end.empty() && !parse_time(window_end, &stop)) {
+        std::cerr << "Invalid window end " << window_end << '\n';
+        return -1;
+    }
+    BoundingBox box {};
+    if (!area.empty()) {
+        if (streaming) {
+            std::cerr << "--area can't be used with --streaming\n";
+            return -1;
+        }
+        if (!parse_area(area, &box)) {
+            std::cerr << "Invalid area " << area << '\n';
+            return -1;
+        }
+    }
 
     // Simulation configuration
     ns3::Time::SetResolution(ns3::Time::NS);
@@ -129,58 +372,186 @@ int main(int argc, char** argv) {
     // ns3::LogComponentEnable("olsr::NeighborTable", ns3::LOG_LEVEL_LOGIC);
     // ns3::LogComponentEnable("olsr::TopologyTable", ns3::LOG_LEVEL_LOGIC);
     // ns3::LogComponentEnable("olsr::multipoint_relay", ns3::LOG_LEVEL_ALL);
+    // ns3::LogComponentEnable("olsr::calculate_routes", ns3::LOG_LEVEL_LOGIC);
 
-    // Create aircraft and ground stations
-    const auto flights = load_flights(argv[1]);
-    auto aircraft = create_aircraft(flights);
-    auto ground_stations = create_ground_stations();
+    // ns-3 logging is not thread-safe, so logged route calculations must run on one thread
+    if (olsr::route_logging_enabled() && route_threads != 1) {
+        NS_LOG_WARN("Calculating routes on one thread instead of --route-threads=" << route_threads
+            << " because route calculations are logged");
+        route_threads = 1;
+    }
+    BatchRunner::Default().SetThreads(route_threads);
 
-    // Create ether and container of all nodes
-    ns3::NodeContainer all_nodes(aircraft, ground_stations);
     Ether ether;
     // 300 km
     ether.SetRange(300000);
-    for (auto iter = all_nodes.Begin(); iter != all_nodes.End(); ++iter) {
-        ether.AddDevice((*iter)->GetObject<MeshNetDevice>());
-    }
-
-    // Set up network protocol
-    for (auto iter = all_nodes.Begin(); iter != all_nodes.End(); ++iter) {
-        auto net_device = (*iter)->GetObject<MeshNetDevice>();
-        assert(net_device);
-        auto protocol = create_protocol();
-        protocol->Start();
-        protocol->SetNetDevice(net_device);
-        (*iter)->AggregateObject(protocol);
-    }
-
-    // Create applications
+    auto packet_recorder = ns3::CreateObject<PacketRecorder>();
     AdsBSenderHelper sender_helper(ns3::Minutes(30));
-    auto adsb_senders = sender_helper.Install(aircraft);
 
-    // Create recorder
-    record::SessionRecorder recorder(flights.first_departure_time(), ns3::Minutes(10), std::move(all_nodes));
-    recorder.Start();
-
-    // Create packet recorder
-    auto packet_recorder = ns3::CreateObject<PacketRecorder>();
-    for (auto iter = all_nodes.Begin(); iter != all_nodes.End(); ++iter) {
-        auto node = *iter;
-        auto protocol = node->GetObject<NetworkProtocol>();
-        assert(protocol);
-        protocol->SetPacketRecorder(packet_recorder);
+    auto ground_stations = create_ground_stations();
+    for (auto iter = ground_stations.Begin(); iter != ground_stations.End(); ++iter) {
+        connect_node(*iter, ether, packet_recorder, protocol_options, jitter);
+        // Ground stations receive all application traffic
+        const auto olsr = (*iter)->GetObject<olsr::Olsr>();
+        if (olsr) {
+            olsr->SetGateway(true);
+        }
     }
 
-    adsb_senders.Start(ns3::Seconds(0));
+    std::unique_ptr<FlightStream> stream;
+    std::unique_ptr<record::SessionRecorder> recorder;
+    // Nodes of streamed flights that are in the air, by flight index
+    std::unordered_map<std::size_t, ns3::Ptr<ns3::Node>> airborne;
+    std::size_t peak_airborne = 0;
+    if (streaming) {
+        // Create each aircraft shortly before it departs
+        if (has_window) {
+            filter.airborne_between(start, stop);
+        }
+        stream.reset(new FlightStream(kml_path, cache_path, filter));
+        const auto epoch = stream->FirstDepartureTime();
+        recorder.reset(new record::SessionRecorder(epoch, ns3::Minutes(10), ns3::NodeContainer(ground_stations)));
+        stream->SetDepartureCallback([&](std::size_t index, const flightkml::Flight& flight) {
+            const IcaoAddress address(static_cast<std::uint32_t>(index));
+            NS_LOG_INFO("Flight " << index << ": address " << address);
+            auto node = create_aircraft_node(flight, epoch, address);
+            connect_node(node, ether, packet_recorder, protocol_options, jitter);
+            sender_helper.Install(ns3::NodeContainer(node)).Start(ns3::Seconds(0));
+            recorder->AddNode(node);
+            airborne.emplace(index, node);
+            peak_airborne = std::max(peak_airborne, airborne.size());
+        });
+        stream->SetArrivalCallback([&](std::size_t index) {
+            // ns-3 can't remove nodes, but everything that runs or grows stops
+            const auto iter = airborne.find(index);
+            assert(iter != airborne.end());
+            const auto node = iter->second;
+            ether.RemoveDevice(node->GetObject<MeshNetDevice>());
+            node->GetObject<NetworkProtocol>()->Stop();
+            for (std::uint32_t i = 0; i < node->GetNApplications(); i++) {
+                const auto sender = ns3::DynamicCast<AdsBSender>(node->GetApplication(i));
+                if (sender) {
+                    sender->Stop();
+                }
+            }
+            recorder->RemoveNode(node);
+            airborne.erase(iter);
+        });
+        stream->Start();
+    } else {
+        // Create all aircraft
+        auto flights = load_flights(kml_path, cache_path, filter);
+        if (has_window || !area.empty()) {
+            // Select from the index of the loaded flights
+            std::vector<std::size_t> selected;
+            if (area.empty()) {
+                selected = flights.airborne(start, stop);
+            } else if (has_window) {
+                selected = flights.airborne_within(start, stop, box);
+            } else {
+                selected = flights.within(box);
+            }
+            NS_LOG_INFO("Selected " << selected.size() << " of " << flights.flights().size() << " flights");
+            flights.retain(selected);
+        }
+        NS_LOG_INFO("Flight points use " << flights.point_memory_usage() / 1024 << " KiB");
+        auto aircraft = create_aircraft(flights);
+        // Waypoints have been copied into the mobility models
+        flights.release_points();
+        for (auto iter = aircraft.Begin(); iter != aircraft.End(); ++iter) {
+            connect_node(*iter, ether, packet_recorder, protocol_options, jitter);
+        }
+
+        // Create applications
+        auto adsb_senders = sender_helper.Install(aircraft);
+        adsb_senders.Start(ns3::Seconds(0));
+
+        recorder.reset(new record::SessionRecorder(flights.first_departure_time(), ns3::Minutes(10), ns3::NodeContainer(aircraft, ground_stations)));
+    }
+    recorder->Start();
 
     NS_LOG_INFO("Running simulation");
     // Was 36 hours for simulation used in presentation
     ns3::Simulator::Stop(ns3::Hours(36));
+    const auto run_start = std::chrono::steady_clock::now();
     ns3::Simulator::Run();
+    const auto run_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+
+    // OLSR flooding statistics
+    std::uint64_t topology_control_forwarded = 0;
+    std::uint64_t topology_control_suppressed = 0;
+    std::uint64_t topology_control_bytes_sent = 0;
+    std::uint64_t duplicate_evictions = 0;
+    std::uint64_t route_updates = 0;
+    std::uint64_t hello_bytes_sent = 0;
+    std::uint64_t olsr_nodes = 0;
+    std::uint64_t routes = 0;
+    std::size_t max_routes = 0;
+    std::uint64_t topology_entries = 0;
+    std::size_t max_topology_entries = 0;
+    std::uint64_t cluster_members = 0;
+    std::size_t max_cluster_members = 0;
+    std::uint64_t max_topology_control_bytes_sent = 0;
+    for (auto iter = ns3::NodeList::Begin(); iter != ns3::NodeList::End(); ++iter) {
+        const auto olsr = (*iter)->GetObject<olsr::Olsr>();
+        if (olsr) {
+            topology_control_forwarded += olsr->TopologyControlForwarded();
+            topology_control_suppressed += olsr->TopologyControlSuppressed();
+            topology_control_bytes_sent += olsr->TopologyControlBytesSent();
+            duplicate_evictions += olsr->DuplicateEvictions();
+            route_updates += olsr->RouteUpdates();
+            hello_bytes_sent += olsr->HelloBytesSent();
+            olsr_nodes++;
+            routes += olsr->Routing().size();
+            max_routes = std::max(max_routes, olsr->Routing().size());
+            topology_entries += olsr->Topology().size();
+            max_topology_entries = std::max(max_topology_entries, olsr->Topology().size());
+            cluster_members += olsr->Clusters().Members().size();
+            max_cluster_members = std::max(max_cluster_members, olsr->Clusters().Members().size());
+            max_topology_control_bytes_sent = std::max(max_topology_control_bytes_sent, olsr->TopologyControlBytesSent());
+        }
+    }
+    NS_LOG_INFO("Topology control messages forwarded: " << topology_control_forwarded
+        << ", duplicates suppressed: " << topology_control_suppressed
+        << ", bytes sent: " << topology_control_bytes_sent
+        << ", duplicate entries evicted before expiry: " << duplicate_evictions
+        << ", route updates: " << route_updates);
+    const auto per_node = [olsr_nodes](std::uint64_t total) {
+        return olsr_nodes != 0 ? static_cast<double>(total) / olsr_nodes : 0.0;
+    };
+    NS_LOG_INFO("Routing table entries: " << routes << " in " << olsr_nodes << " nodes, average "
+        << per_node(routes) << ", max " << max_routes
+        << (gateway_routes_only ? " (gateway routes only)" : " (all routes)"));
+    // With clustering, per-node state and traffic should grow more slowly than the number of nodes
+    NS_LOG_INFO("Per-node state, average and max: topology entries " << per_node(topology_entries)
+        << ", " << max_topology_entries << "; cluster members " << per_node(cluster_members)
+        << ", " << max_cluster_members << "; topology control bytes sent " << per_node(topology_control_bytes_sent)
+        << ", " << max_topology_control_bytes_sent << " (cell size " << cluster_cell_size << " degrees)");
+    NS_LOG_INFO("Hello bytes sent: " << hello_bytes_sent << (compact_hello ? " (compact)" : " (full)"));
+    const auto data_sent = packet_recorder->Sent(PacketRecorder::PacketType::Data);
+    const auto data_received = packet_recorder->Received(PacketRecorder::PacketType::Data);
+    NS_LOG_INFO("Data packets delivered: " << data_received << " of " << data_sent << ", ratio "
+        << (data_sent != 0 ? static_cast<double>(data_received) / data_sent : 0.0)
+        << (link_range > 0 ? ", link lifetime metric on" : ", link lifetime metric off"));
+    const auto& timers = TimerWheel::Default();
+    NS_LOG_INFO("Protocol timer calls: " << timers.Calls() << " in " << timers.TicksRun()
+        << " ticks, peak " << timers.PeakCalls() << " in one tick");
+    const auto& batches = BatchRunner::Default();
+    NS_LOG_INFO("Batched route updates: " << batches.Jobs() << " in " << batches.Batches()
+        << " batches, peak " << batches.PeakJobs() << " in one batch, " << batches.Threads() << " threads");
+    // Compare runs with --route-threads=1 and more threads
+    NS_LOG_INFO("Simulation wall-clock time: " << run_seconds << " s, of which route calculation "
+        << batches.ComputeSeconds() << " s with " << batches.Threads() << " threads");
+    if (streaming) {
+        NS_LOG_INFO("Peak memory with streaming: " << peak_memory_kib() / 1024 << " MiB, "
+            << peak_airborne << " aircraft in the air at once");
+    } else {
+        NS_LOG_INFO("Peak memory with all flights loaded: " << peak_memory_kib() / 1024 << " MiB");
+    }
     ns3::Simulator::Destroy();
     NS_LOG_INFO("Destroyed simulation");
 
-    recorder.WriteJson("log.json");
+    recorder->WriteJson("log.json");
     packet_recorder->WriteCsv("packets.csv");
 
     return 0;
@@ -0,0 +1,164 @@
+#include "batch_runner.h"
+#include <algorithm>
+#include <cassert>
+#include <ns3/simulator.h>
+#include <ns3/log.h>
+
+NS_LOG_COMPONENT_DEFINE("BatchRunner");
+
+BatchRunner::BatchRunner(ns3::Time resolution) :
+    _resolution(resolution),
+    _batches(),
+    _threads(1),
+    _workers(),
+    _mutex(),
+    _work_ready(),
+    _work_done(),
+    _current(nullptr),
+    _next(0),
+    _busy(0),
+    _generation(0),
+    _stopping(false),
+    _batches_run(0),
+    _jobs_run(0),
+    _peak_jobs(0),
+    _compute_time()
+{
+    assert(_resolution.IsStrictlyPositive());
+    SetThreads(0);
+}
+
+BatchRunner::~BatchRunner() {
+    StopWorkers();
+}
+
+BatchRunner& BatchRunner::Default() {
+    // Never destroyed, so that it is still valid when other static objects
+    // are destroyed
+    static BatchRunner* runner = new BatchRunner();
+    return *runner;
+}
+
+void BatchRunner::SetThreads(unsigned int threads) {
+    if (threads == 0) {
+        // hardware_concurrency() may return 0 if it is not known
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    if (threads != _threads) {
+        StopWorkers();
+        _threads = threads;
+    }
+}
+
+ns3::Time BatchRunner::Schedule(ns3::Time delay, callback compute, callback finish) {
+    // Round up to the next tick
+    const auto steps = (ns3::Simulator::Now() + delay).GetTimeStep();
+    const auto resolution = _resolution.GetTimeStep();
+    const auto tick = static_cast<std::uint64_t>((std::max(steps, std::int64_t(0)) + resolution - 1) / resolution);
+    const auto time = _resolution * static_cast<std::int64_t>(tick);
+
+    auto& jobs = _batches[tick];
+    if (jobs.empty()) {
+        ns3::Simulator::Schedule(time - ns3::Simulator::Now(), &BatchRunner::RunBatch, this, tick);
+    }
+    jobs.push_back(Job { std::move(compute), std::move(finish) });
+    return time;
+}
+
+void BatchRunner::RunBatch(std::uint64_t tick) {
+    const auto in_batches = _batches.find(tick);
+    assert(in_batches != _batches.end());
+    // Finish functions may register jobs for this tick, which run in
+    // another batch
+    std::vector<Job> jobs;
+    jobs.swap(in_batches->second);
+    _batches.erase(in_batches);
+    NS_LOG_FUNCTION(this << tick << jobs.size());
+
+    _current = &jobs;
+    _next = 0;
+    const auto start = std::chrono::steady_clock::now();
+    if (_threads > 1 && jobs.size() > 1) {
+        ComputeParallel();
+    } else {
+        ComputeJobs();
+    }
+    _compute_time += std::chrono::steady_clock::now() - start;
+    _current = nullptr;
+    for (auto& job : jobs) {
+        if (job.finish) {
+            job.finish();
+        }
+    }
+
+    _batches_run++;
+    _jobs_run += jobs.size();
+    _peak_jobs = std::max(_peak_jobs, static_cast<std::uint64_t>(jobs.size()));
+}
+
+void BatchRunner::ComputeParallel() {
+    if (_workers.empty()) {
+        // The simulation thread is one of the threads
+        for (unsigned int i = 1; i < _threads; i++) {
+            _workers.emplace_back(&BatchRunner::RunWorker, this, _generation);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _busy = _workers.size();
+        _generation++;
+    }
+    _work_ready.notify_all();
+    ComputeJobs();
+    std::unique_lock<std::mutex> lock(_mutex);
+    _work_done.wait(lock, [this]() { return _busy == 0; });
+}
+
+void BatchRunner::ComputeJobs() {
+    const auto count = _current->size();
+    while (true) {
+        std::size_t index;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            index = _next++;
+        }
+        if (index >= count) {
+            return;
+        }
+        (*_current)[index].compute();
+    }
+}
+
+void BatchRunner::RunWorker(std::uint64_t generation) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _work_ready.wait(lock, [this, generation]() { return _stopping || _generation != generation; });
+        if (_stopping) {
+            return;
+        }
+        generation = _generation;
+        lock.unlock();
+        ComputeJobs();
+        lock.lock();
+        _busy--;
+        if (_busy == 0) {
+            _work_done.notify_one();
+        }
+    }
+}
+
+void BatchRunner::StopWorkers() {
+    if (_workers.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _work_ready.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+    _stopping = false;
+}
@@ -0,0 +1,140 @@
+#ifndef NETWORK_BATCH_RUNNER_H
+#define NETWORK_BATCH_RUNNER_H
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <ns3/nstime.h>
+
+/**
+ * Runs computations of many protocol instances that are due at the same
+ * time in parallel
+ *
+ * Protocols register jobs for a time, which is rounded up to the next tick
+ * of a fixed resolution so that jobs registered at nearby times run
+ * together. One ns-3 event per tick runs the compute functions of all jobs
+ * due at that tick on a pool of threads, and then runs their finish
+ * functions on the simulation thread in the order that the jobs were
+ * registered.
+ *
+ * A compute function may only change the state of its own protocol
+ * instance and must not call ns-3 functions, including logging. With that,
+ * the results do not depend on the number of threads.
+ */
+class BatchRunner {
+public:
+    typedef std::function<void()> callback;
+
+    /**
+     * Creates a batch runner
+     *
+     * @param resolution the length of a tick
+     */
+    BatchRunner(ns3::Time resolution = ns3::MilliSeconds(100));
+    ~BatchRunner();
+    BatchRunner(const BatchRunner& other) = delete;
+    BatchRunner& operator = (const BatchRunner& other) = delete;
+
+    /** Returns the batch runner that network protocols use */
+    static BatchRunner& Default();
+
+    /**
+     * Sets the number of threads that run compute functions, including the
+     * simulation thread
+     *
+     * 0 uses one thread for each hardware thread. 1 runs all jobs on the
+     * simulation thread.
+     */
+    void SetThreads(unsigned int threads);
+    inline unsigned int Threads() const {
+        return _threads;
+    }
+
+    /**
+     * Registers a job to run once
+     *
+     * @param delay the minimum time from now until the job runs
+     * @param compute the function to run in parallel with other jobs
+     * @param finish the function to run on the simulation thread after the
+     * compute functions of the batch, or an empty function
+     * @return the time when the job will run
+     */
+    ns3::Time Schedule(ns3::Time delay, callback compute, callback finish);
+
+    /** Returns the number of batches that have run */
+    inline std::uint64_t Batches() const {
+        return _batches_run;
+    }
+    /** Returns the number of jobs that have run */
+    inline std::uint64_t Jobs() const {
+        return _jobs_run;
+    }
+    /** Returns the largest number of jobs in one batch */
+    inline std::uint64_t PeakJobs() const {
+        return _peak_jobs;
+    }
+    /** Returns the wall-clock time spent running compute functions, in seconds */
+    inline double ComputeSeconds() const {
+        return std::chrono::duration<double>(_compute_time).count();
+    }
+
+private:
+    struct Job {
+        callback compute;
+        callback finish;
+    };
+
+    /** The length of a tick */
+    ns3::Time _resolution;
+    /** Tick -> jobs due at that tick, in registration order */
+    std::map<std::uint64_t, std::vector<Job>> _batches;
+    /** Number of threads that run compute functions */
+    unsigned int _threads;
+    /** Worker threads, started when the first batch runs in parallel */
+    std::vector<std::thread> _workers;
+    /** Protects the fields below that workers use */
+    std::mutex _mutex;
+    /** Notified when a batch is ready or the workers should stop */
+    std::condition_variable _work_ready;
+    /** Notified when the last worker finishes a batch */
+    std::condition_variable _work_done;
+    /** The batch that is running, if any */
+    std::vector<Job>* _current;
+    /** Index of the next job in _current to compute */
+    std::size_t _next;
+    /** Number of workers that have not finished the current batch */
+    std::size_t _busy;
+    /** Incremented for each batch, so that workers can see new batches */
+    std::uint64_t _generation;
+    /** True when the workers should exit */
+    bool _stopping;
+    /** Number of batches that have run */
+    std::uint64_t _batches_run;
+    /** Number of jobs that have run */
+    std::uint64_t _jobs_run;
+    /** Largest number of jobs in one batch */
+    std::uint64_t _peak_jobs;
+    /** Wall-clock time spent running compute functions */
+    std::chrono::steady_clock::duration _compute_time;
+
+    /** Event callback: Runs the jobs due at a tick */
+    void RunBatch(std::uint64_t tick);
+    /** Runs the compute functions of _current in parallel */
+    void ComputeParallel();
+    /** Runs compute functions of _current until none are left */
+    void ComputeJobs();
+    /**
+     * Worker thread function
+     *
+     * @param generation the value of _generation when the worker was started
+     */
+    void RunWorker(std::uint64_t generation);
+    /** Stops and joins the worker threads */
+    void StopWorkers();
+};
+
+#endif
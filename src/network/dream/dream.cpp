@@ -56,10 +56,16 @@ void Dream::SetNetDevice(ns3::Ptr<MeshNetDevice> net_device) {
 }
 
 void Dream::Start() {
-    ns3::Simulator::Schedule(_hello_interval, &Dream::SendHello, this);
-    ns3::Simulator::Schedule(_frequent_position_interval, &Dream::SendFrequentPosition, this);
-    ns3::Simulator::Schedule(_infrequent_position_interval, &Dream::SendInfrequentPosition, this);
-    ns3::Simulator::Schedule(_cleanup_interval, &Dream::Cleanup, this);
+    RegisterTimer(_hello_interval, [this]() { SendHello(); });
+    RegisterTimer(_frequent_position_interval, [this]() { SendFrequentPosition(); });
+    RegisterTimer(_infrequent_position_interval, [this]() { SendInfrequentPosition(); });
+    RegisterTimer(_cleanup_interval, [this]() { Cleanup(); });
+}
+
+void Dream::Stop() {
+    NetworkProtocol::Stop();
+    _routing.clear();
+    _neighbors.clear();
 }
 
 void Dream::Send(ns3::Packet packet, IcaoAddress destination) {
@@ -224,25 +230,20 @@ void Dream::SendHello() {
     // Send to all neighbors
     RecordPacketSent(packet.GetUid(), PacketRecorder::PacketType::Management);
     SendPacket(packet, IcaoAddress::Broadcast());
-
-    ns3::Simulator::Schedule(_hello_interval, &Dream::SendHello, this);
 }
 void Dream::SendInfrequentPosition() {
     ADDR_LOG_INFO("Sending infrequent position");
     SendPosition(_infrequent_max_distance);
-    ns3::Simulator::Schedule(_infrequent_position_interval, &Dream::SendInfrequentPosition, this);
 }
 void Dream::SendFrequentPosition() {
     ADDR_LOG_INFO("Sending frequent position");
     SendPosition(_frequent_max_distance);
-    ns3::Simulator::Schedule(_frequent_position_interval, &Dream::SendFrequentPosition, this);
 }
 
 void Dream::Cleanup() {
     NS_LOG_FUNCTION(this);
     _neighbors.RemoveExpired();
     _routing.RemoveExpired();
-    ns3::Simulator::Schedule(_cleanup_interval, &Dream::Cleanup, this);
 }
 
 void Dream::SetReceiveCallback(receive_callback callback) {
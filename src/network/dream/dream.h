@@ -27,6 +27,10 @@ public:
      * Starts sending messages and performing other network operations
      */
     virtual void Start() override;
+    /**
+     * Stops sending messages and clears all tables
+     */
+    virtual void Stop() override;
 
     /**
      * Sends a packet to the specified destination
@@ -24,20 +24,18 @@ NeighborTable::NeighborTable(ns3::Time ttl) :
 }
 
 void NeighborTable::RemoveExpired() {
-    const auto now = ns3::Simulator::Now();
-    for (auto iter = _table.begin(); iter != _table.end(); /* none */) {
-        const auto& table_entry = iter->second;
-        if (now - table_entry.LastUpdated() > _ttl) {
-            // Delete
-            // This invalidates the iterator to the removed element,
-            // but not to other elements
-            const auto to_remove = iter;
-            iter = ++iter;
-            _table.erase(to_remove);
+    const auto cutoff = ns3::Simulator::Now() - _ttl;
+    _expiry.PopBefore(cutoff, [&](IcaoAddress address) {
+        const auto iter = _table.find(address);
+        if (iter == _table.end()) {
+            return;
+        }
+        if (iter->second.LastUpdated() < cutoff) {
+            _table.erase(iter);
         } else {
-            iter = ++iter;
+            _expiry.Push(address, iter->second.LastUpdated());
         }
-    }
+    });
 }
 
 NeighborTable::iterator NeighborTable::Find(IcaoAddress address) {
@@ -66,10 +64,14 @@ std::size_t NeighborTable::size() const {
 }
 void NeighborTable::clear() {
     _table.clear();
+    _expiry.clear();
 }
 
 void NeighborTable::Insert(const NeighborTableEntry& entry) {
-    _table.insert(std::make_pair(entry.Address(), entry));
+    const auto inserted = _table.insert(std::make_pair(entry.Address(), entry));
+    if (inserted.second) {
+        _expiry.Push(entry.Address(), entry.LastUpdated());
+    }
 }
 
 }
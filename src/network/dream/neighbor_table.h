@@ -6,6 +6,7 @@
 #include <ns3/nstime.h>
 #include <ns3/vector.h>
 #include "address/icao_address.h"
+#include "util/expiry_queue.h"
 
 namespace dream {
 
@@ -45,6 +46,8 @@ private:
     std::map<IcaoAddress, NeighborTableEntry> _table;
     /** The time before entries expire */
     ns3::Time _ttl;
+    /** Addresses of entries in the order they may expire */
+    util::ExpiryQueue<IcaoAddress> _expiry;
 public:
     NeighborTable(ns3::Time ttl = ns3::Time());
     /**
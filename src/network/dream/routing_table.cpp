@@ -17,7 +17,8 @@ void RoutingTable::Entry::MarkSeen() {
 
 RoutingTable::RoutingTable(const ns3::Time& ttl) :
     _table(),
-    _ttl(ttl)
+    _ttl(ttl),
+    _expiry()
 {
 }
 
@@ -25,21 +26,25 @@ RoutingTable::iterator RoutingTable::Find(IcaoAddress destination) {
     return iterator(_table.find(destination));
 }
 void RoutingTable::Insert(Entry entry) {
-    _table.insert(std::make_pair(entry.Destination(), entry));
+    const auto inserted = _table.insert(std::make_pair(entry.Destination(), entry));
+    if (inserted.second) {
+        _expiry.Push(entry.Destination(), entry.LastTime());
+    }
 }
 
 void RoutingTable::RemoveExpired() {
-    const auto now = ns3::Simulator::Now();
-    for (auto iter = _table.begin(); iter != _table.end(); /* nothing */) {
-        const auto age = now - iter->second.LastTime();
-        if (age > _ttl) {
-            const auto to_remove = iter;
-            ++iter;
-            _table.erase(to_remove);
+    const auto cutoff = ns3::Simulator::Now() - _ttl;
+    _expiry.PopBefore(cutoff, [&](IcaoAddress destination) {
+        const auto iter = _table.find(destination);
+        if (iter == _table.end()) {
+            return;
+        }
+        if (iter->second.LastTime() < cutoff) {
+            _table.erase(iter);
         } else {
-            ++iter;
+            _expiry.Push(destination, iter->second.LastTime());
         }
-    }
+    });
 }
 
 RoutingTable::PrintTable::PrintTable(const RoutingTable& table) :
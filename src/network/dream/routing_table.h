@@ -3,6 +3,7 @@
 
 #include "address/icao_address.h"
 #include "util/value_iterator.h"
+#include "util/expiry_queue.h"
 #include <ns3/nstime.h>
 #include <ns3/vector.h>
 #include <cstdint>
@@ -88,6 +89,7 @@ public:
     }
     inline void clear() {
         _table.clear();
+        _expiry.clear();
     }
 
     iterator Find(IcaoAddress destination);
@@ -102,6 +104,8 @@ private:
     std::map<IcaoAddress, Entry> _table;
     /** Time since last update threshold for deleting old entries */
     ns3::Time _ttl;
+    /** Destinations of entries in the order they may expire */
+    util::ExpiryQueue<IcaoAddress> _expiry;
 };
 
 }
@@ -1,4 +1,14 @@
 #include "network_protocol.h"
+#include "timer_wheel.h"
+#include <algorithm>
+
+NetworkProtocol::NetworkProtocol() :
+    _timer_phase(),
+    _timer_jitter(),
+    _timer_random(ns3::CreateObject<ns3::UniformRandomVariable>()),
+    _timers()
+{
+}
 
 ns3::TypeId NetworkProtocol::GetTypeId() {
     static ns3::TypeId id = ns3::TypeId("NetworkProtocol")
@@ -21,3 +31,26 @@ void NetworkProtocol::RecordPacketReceived(std::uint64_t id) {
         _packet_recorder->RecordPacketReceived(id);
     }
 }
+
+void NetworkProtocol::SetTimerJitter(ns3::Time phase, ns3::Time jitter) {
+    _timer_phase = phase;
+    _timer_jitter = jitter;
+}
+
+std::int64_t NetworkProtocol::AssignStreams(std::int64_t stream) {
+    _timer_random->SetStream(stream);
+    return 1;
+}
+
+void NetworkProtocol::RegisterTimer(ns3::Time interval, std::function<void()> function) {
+    const auto phase = ns3::Seconds(_timer_random->GetValue(0, _timer_phase.GetSeconds()));
+    const auto jitter = std::min(_timer_jitter, interval / 2);
+    _timers.push_back(TimerWheel::Default().Register(interval + phase, interval, std::move(function), jitter, _timer_random));
+}
+
+void NetworkProtocol::Stop() {
+    for (const auto id : _timers) {
+        TimerWheel::Default().Cancel(id);
+    }
+    _timers.clear();
+}
@@ -1,10 +1,14 @@
 #ifndef NETWORK_NETWORK_PROTOCOL_H
 #define NETWORK_NETWORK_PROTOCOL_H
 #include <functional>
+#include <vector>
 #include <ns3/object.h>
 #include <ns3/packet.h>
+#include <ns3/nstime.h>
+#include <ns3/random-variable-stream.h>
 #include "address/icao_address.h"
 #include "packet_recorder/packet_recorder.h"
+#include "network/timer_wheel.h"
 
 // Forward-declare
 class MeshNetDevice;
@@ -20,6 +24,13 @@ public:
      * Starts sending hello messages and performing other network operations
      */
     virtual void Start() = 0;
+    /**
+     * Stops all timers and releases the state of this protocol, for a node
+     * that has left the simulation
+     *
+     * Implementations in subclasses must call this implementation.
+     */
+    virtual void Stop();
 
     /**
      * Sends a packet to the specified destination
@@ -40,6 +51,25 @@ public:
      */
     void SetPacketRecorder(ns3::Ptr<PacketRecorder> recorder);
 
+    /**
+     * Sets the random timing of periodic messages and other timers
+     *
+     * This must be called before Start(). The first call of each timer is
+     * delayed by a random time up to phase, in addition to its interval.
+     * Each later call is delayed by a random time up to jitter, or up to
+     * half of the interval if that is smaller, without delaying the calls
+     * after it.
+     */
+    void SetTimerJitter(ns3::Time phase, ns3::Time jitter);
+    /**
+     * Assigns a fixed random variable stream number to the random variables
+     * used by this protocol
+     *
+     * Returns the number of streams used.
+     */
+    std::int64_t AssignStreams(std::int64_t stream);
+
+    NetworkProtocol();
     /** Empty destructor */
     virtual ~NetworkProtocol() = default;
 
@@ -50,9 +80,23 @@ protected:
     void RecordPacketSent(std::uint64_t id, PacketRecorder::PacketType type);
     void RecordPacketReceived(std::uint64_t id);
 
+    /**
+     * Registers a function to be called periodically with the timer wheel,
+     * applying the phase and jitter from SetTimerJitter()
+     */
+    void RegisterTimer(ns3::Time interval, std::function<void()> function);
+
 private:
     /** The packet recorder */
     ns3::Ptr<PacketRecorder> _packet_recorder;
+    /** Maximum random delay before the first call of each timer */
+    ns3::Time _timer_phase;
+    /** Maximum random delay of each timer call */
+    ns3::Time _timer_jitter;
+    /** Source of timer phases and jitter */
+    ns3::Ptr<ns3::UniformRandomVariable> _timer_random;
+    /** Timers registered with RegisterTimer() */
+    std::vector<TimerWheel::TimerId> _timers;
 };
 
 #endif
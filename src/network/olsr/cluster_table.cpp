@@ -0,0 +1,153 @@
+#include "cluster_table.h"
+#include <ns3/simulator.h>
+#include <ns3/log.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <deque>
+
+NS_LOG_COMPONENT_DEFINE("olsr::ClusterTable");
+
+namespace olsr {
+
+ClusterTable::ClusterTable(double cell_size) :
+    _cell_size(cell_size),
+    _columns(static_cast<std::uint32_t>(std::ceil(360 / cell_size)))
+{
+    assert(cell_size > 0);
+    assert(std::ceil(180 / cell_size) * _columns <= 65536);
+}
+
+ClusterTable::cell_type ClusterTable::CellOf(const ns3::Vector& position) const {
+    // Geocentric latitude is accurate enough for cells
+    const auto radians = 180 / M_PI;
+    const auto latitude = std::atan2(position.z, std::hypot(position.x, position.y)) * radians;
+    const auto longitude = std::atan2(position.y, position.x) * radians;
+    const auto rows = static_cast<std::uint32_t>(std::ceil(180 / _cell_size));
+    const auto row = std::min(rows - 1, static_cast<std::uint32_t>((latitude + 90) / _cell_size));
+    const auto column = std::min(_columns - 1, static_cast<std::uint32_t>((longitude + 180) / _cell_size));
+    return static_cast<cell_type>(row * _columns + column);
+}
+
+void ClusterTable::UpdateMember(IcaoAddress address, cell_set adjacent_cells, ns3::Time expires) {
+    auto inserted = _members.insert(std::make_pair(address, Member { cell_set(), expires }));
+    auto& member = inserted.first->second;
+    member.adjacent_cells = std::move(adjacent_cells);
+    member.expires = expires;
+}
+
+void ClusterTable::ClearMembers() {
+    _members.clear();
+}
+
+IcaoAddress ClusterTable::ElectHead(IcaoAddress self) const {
+    // Members are sorted by address
+    if (!_members.empty() && _members.begin()->first < self) {
+        return _members.begin()->first;
+    }
+    return self;
+}
+
+void ClusterTable::UpdateCell(cell_type cell, IcaoAddress head, cell_set adjacent_cells, ns3::Time expires) {
+    auto inserted = _cells.insert(std::make_pair(cell, Cell { head, cell_set(), expires }));
+    auto& entry = inserted.first->second;
+    if (inserted.second || entry.adjacent_cells != adjacent_cells) {
+        NS_LOG_LOGIC("Cell " << cell << " changed");
+        _next_cells_from = boost::none;
+    }
+    entry.head = head;
+    entry.adjacent_cells = std::move(adjacent_cells);
+    entry.expires = expires;
+}
+
+void ClusterTable::UpdateLocation(IcaoAddress address, cell_type cell, ns3::Time expires) {
+    auto inserted = _locations.insert(std::make_pair(address, std::make_pair(cell, expires)));
+    inserted.first->second = std::make_pair(cell, expires);
+}
+
+boost::optional<ClusterTable::cell_type> ClusterTable::FindLocation(IcaoAddress address) const {
+    const auto in_locations = _locations.find(address);
+    if (in_locations == _locations.end()) {
+        return boost::none;
+    }
+    return in_locations->second.first;
+}
+
+boost::optional<ClusterTable::cell_type> ClusterTable::NextCell(cell_type from, cell_type to) {
+    if (!_next_cells_from || *_next_cells_from != from) {
+        // Breadth-first search from the source cell. Each cell records the
+        // first cell after the source on the way to it.
+        _next_cells.clear();
+        std::vector<std::pair<cell_type, cell_type>> reached;
+        std::deque<std::pair<cell_type, cell_type>> queue;
+        util::FlatSet<cell_type> visited;
+        visited.insert(from);
+        queue.push_back(std::make_pair(from, from));
+        while (!queue.empty()) {
+            const auto current = queue.front();
+            queue.pop_front();
+            const auto in_cells = _cells.find(current.first);
+            if (in_cells == _cells.end()) {
+                continue;
+            }
+            for (const auto adjacent : in_cells->second.adjacent_cells) {
+                if (visited.insert(adjacent)) {
+                    const auto first = current.first == from ? adjacent : current.second;
+                    reached.push_back(std::make_pair(adjacent, first));
+                    queue.push_back(std::make_pair(adjacent, first));
+                }
+            }
+        }
+        _next_cells.assign(std::move(reached));
+        _next_cells_from = from;
+    }
+    const auto in_next = _next_cells.find(to);
+    if (in_next == _next_cells.end()) {
+        return boost::none;
+    }
+    return in_next->second;
+}
+
+void ClusterTable::RemoveExpired() {
+    const auto now = ns3::Simulator::Now();
+    _members.erase_if([now](const std::pair<IcaoAddress, Member>& entry) {
+        return entry.second.expires <= now;
+    });
+    const auto cells_before = _cells.size();
+    _cells.erase_if([now](const std::pair<cell_type, Cell>& entry) {
+        return entry.second.expires <= now;
+    });
+    if (_cells.size() != cells_before) {
+        _next_cells_from = boost::none;
+    }
+    _locations.erase_if([now](const std::pair<IcaoAddress, std::pair<cell_type, ns3::Time>>& entry) {
+        return entry.second.second <= now;
+    });
+}
+
+void ClusterTable::clear() {
+    _members.clear();
+    _cells.clear();
+    _locations.clear();
+    _next_cells_from = boost::none;
+    _next_cells.clear();
+}
+
+ClusterTable::PrintTable::PrintTable(const ClusterTable& table) :
+    _table(table)
+{
+}
+std::ostream& operator << (std::ostream& stream, const ClusterTable::PrintTable& pt) {
+    const auto& table = pt._table;
+    stream << "| Cell | Head | Adjacent cells |\n";
+    for (const auto& entry : table.Cells()) {
+        stream << " " << entry.first << " | " << entry.second.head << " |";
+        for (const auto adjacent : entry.second.adjacent_cells) {
+            stream << ' ' << adjacent;
+        }
+        stream << " |\n";
+    }
+    return stream;
+}
+
+}
@@ -0,0 +1,125 @@
+#ifndef NETWORK_OLSR_CLUSTER_TABLE_H
+#define NETWORK_OLSR_CLUSTER_TABLE_H
+#include "address/icao_address.h"
+#include "util/flat_map.h"
+#include <ns3/nstime.h>
+#include <ns3/vector.h>
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <ostream>
+
+namespace olsr {
+
+/**
+ * State for two-level clustered routing
+ *
+ * The surface of the Earth is divided into cells of equal latitude and
+ * longitude size. The nodes in each cell form a cluster, and the member
+ * with the lowest address is its head. Members only keep the topology of
+ * their own cell, and the head of each cell advertises the cells next to
+ * it to all nodes. A packet for a destination in another cell is forwarded
+ * toward the next cell on the shortest path of cells.
+ */
+class ClusterTable {
+public:
+    /** A cell index */
+    typedef std::uint16_t cell_type;
+    /** A set of cells */
+    typedef util::FlatSet<cell_type> cell_set;
+
+    /** A node in the same cell as this node, from its topology control messages */
+    struct Member {
+        /** The cells of the neighbors of the member, other than its own cell */
+        cell_set adjacent_cells;
+        /** The time when this entry expires */
+        ns3::Time expires;
+    };
+    /** A cell, from the topology control messages of its head */
+    struct Cell {
+        /** The address of the cluster head */
+        IcaoAddress head;
+        /** The cells next to this cell */
+        cell_set adjacent_cells;
+        /** The time when this entry expires */
+        ns3::Time expires;
+    };
+
+private:
+    /** Cell size, degrees of latitude and longitude */
+    double _cell_size;
+    /** Number of cells in each row of latitude */
+    std::uint32_t _columns;
+    /** Members of the cell of this node */
+    util::FlatMap<IcaoAddress, Member> _members;
+    /** All cells with known heads */
+    util::FlatMap<cell_type, Cell> _cells;
+    /** Cluster heads and gateways -> cell and expiry time */
+    util::FlatMap<IcaoAddress, std::pair<cell_type, ns3::Time>> _locations;
+    /** The cell that _next_cells was calculated from, if it is valid */
+    boost::optional<cell_type> _next_cells_from;
+    /** Destination cell -> next cell on a shortest path */
+    util::FlatMap<cell_type, cell_type> _next_cells;
+
+public:
+    /**
+     * Creates a table
+     *
+     * @param cell_size the size of each cell in degrees, so that there are
+     * at most 65536 cells
+     */
+    ClusterTable(double cell_size = 5);
+
+    /** Returns the cell that contains a position in ECEF coordinates */
+    cell_type CellOf(const ns3::Vector& position) const;
+
+    /** Adds or refreshes a member of the cell of this node */
+    void UpdateMember(IcaoAddress address, cell_set adjacent_cells, ns3::Time expires);
+    /** Removes all members, when this node moves to another cell */
+    void ClearMembers();
+    inline const util::FlatMap<IcaoAddress, Member>& Members() const {
+        return _members;
+    }
+    /**
+     * Returns the head of the cluster of this node: the lowest address
+     * among this node and the known members
+     */
+    IcaoAddress ElectHead(IcaoAddress self) const;
+
+    /** Adds or refreshes a cell advertised by its head */
+    void UpdateCell(cell_type cell, IcaoAddress head, cell_set adjacent_cells, ns3::Time expires);
+    inline const util::FlatMap<cell_type, Cell>& Cells() const {
+        return _cells;
+    }
+
+    /** Records the cell of a cluster head or gateway */
+    void UpdateLocation(IcaoAddress address, cell_type cell, ns3::Time expires);
+    /** Returns the cell of a cluster head or gateway, if it is known */
+    boost::optional<cell_type> FindLocation(IcaoAddress address) const;
+
+    /**
+     * Returns the next cell on a shortest path from one cell to another
+     * through the known cells, if there is a path
+     *
+     * The paths from the most recent source cell are cached until the
+     * cells change.
+     */
+    boost::optional<cell_type> NextCell(cell_type from, cell_type to);
+
+    /** Removes entries that have expired */
+    void RemoveExpired();
+    /** Removes all entries */
+    void clear();
+
+    /** Prints the cells in a table */
+    class PrintTable {
+    private:
+        const ClusterTable& _table;
+    public:
+        PrintTable(const ClusterTable& table);
+        friend std::ostream& operator << (std::ostream& stream, const PrintTable& pt);
+    };
+};
+
+}
+
+#endif
@@ -0,0 +1,148 @@
+#include "duplicate_set.h"
+#include <algorithm>
+#include <cassert>
+#include <ns3/simulator.h>
+
+namespace olsr {
+
+namespace {
+
+std::uint32_t make_key(IcaoAddress originator, std::uint8_t sequence) {
+    return (originator.Value() << 8) | sequence;
+}
+
+}
+
+DuplicateSet::DuplicateSet(ns3::Time hold_time, std::size_t capacity, std::size_t max_capacity) :
+    _ring(),
+    _head(0),
+    _count(0),
+    _slots(),
+    _hold_time(hold_time),
+    _initial_capacity(capacity),
+    _max_capacity(max_capacity),
+    _live_evictions(0)
+{
+    assert(capacity != 0);
+    assert(max_capacity >= capacity);
+    Allocate(capacity);
+}
+
+void DuplicateSet::Allocate(std::size_t capacity) {
+    _ring.assign(capacity, Record());
+    _head = 0;
+    _count = 0;
+    // At most half of the slots are used
+    std::size_t slot_count = 1;
+    while (slot_count < 2 * capacity) {
+        slot_count *= 2;
+    }
+    _slots.assign(slot_count, 0);
+}
+
+void DuplicateSet::Grow() {
+    std::vector<Record> records;
+    records.reserve(_count);
+    for (std::size_t i = 0; i < _count; i++) {
+        records.push_back(_ring[(_head + i) % _ring.size()]);
+    }
+    Allocate(std::min(2 * _ring.size(), _max_capacity));
+    for (const auto& record : records) {
+        _ring[_count] = record;
+        auto slot = HomeSlot(record.key);
+        while (_slots[slot] != 0) {
+            slot = (slot + 1) & (_slots.size() - 1);
+        }
+        _slots[slot] = static_cast<std::uint32_t>(_count + 1);
+        _count++;
+    }
+}
+
+bool DuplicateSet::Insert(IcaoAddress originator, std::uint8_t sequence) {
+    RemoveExpired();
+    const auto key = make_key(originator, sequence);
+    if (FindSlot(key) != _slots.size()) {
+        return false;
+    }
+    if (_count == _ring.size()) {
+        // Expired entries have been removed, so all entries are live
+        if (_ring.size() < _max_capacity) {
+            Grow();
+        } else {
+            RemoveOldest();
+            _live_evictions++;
+        }
+    }
+    const auto position = (_head + _count) % _ring.size();
+    _ring[position] = Record { key, ns3::Simulator::Now() + _hold_time };
+    _count++;
+    auto slot = HomeSlot(key);
+    while (_slots[slot] != 0) {
+        slot = (slot + 1) & (_slots.size() - 1);
+    }
+    _slots[slot] = static_cast<std::uint32_t>(position + 1);
+    return true;
+}
+
+std::size_t DuplicateSet::size() {
+    RemoveExpired();
+    return _count;
+}
+
+void DuplicateSet::clear() {
+    Allocate(_initial_capacity);
+}
+
+std::size_t DuplicateSet::HomeSlot(std::uint32_t key) const {
+    // Mix the bits so that sequential addresses and sequence numbers spread out
+    key ^= key >> 16;
+    key *= 0x45d9f3bu;
+    key ^= key >> 16;
+    return key & (_slots.size() - 1);
+}
+
+std::size_t DuplicateSet::FindSlot(std::uint32_t key) const {
+    auto slot = HomeSlot(key);
+    while (_slots[slot] != 0) {
+        if (_ring[_slots[slot] - 1].key == key) {
+            return slot;
+        }
+        slot = (slot + 1) & (_slots.size() - 1);
+    }
+    return _slots.size();
+}
+
+void DuplicateSet::RemoveSlot(std::size_t slot) {
+    const auto mask = _slots.size() - 1;
+    _slots[slot] = 0;
+    // Move back entries that would no longer be found past the empty slot
+    auto next = (slot + 1) & mask;
+    while (_slots[next] != 0) {
+        const auto home = HomeSlot(_ring[_slots[next] - 1].key);
+        // Move if the home slot is not cyclically in (slot, next]
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            _slots[slot] = _slots[next];
+            _slots[next] = 0;
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
+void DuplicateSet::RemoveOldest() {
+    assert(_count != 0);
+    const auto slot = FindSlot(_ring[_head].key);
+    assert(slot != _slots.size());
+    RemoveSlot(slot);
+    _head = (_head + 1) % _ring.size();
+    _count--;
+}
+
+void DuplicateSet::RemoveExpired() {
+    const auto now = ns3::Simulator::Now();
+    while (_count != 0 && _ring[_head].expires <= now) {
+        RemoveOldest();
+    }
+}
+
+}
@@ -0,0 +1,105 @@
+#ifndef NETWORK_OLSR_DUPLICATE_SET_H
+#define NETWORK_OLSR_DUPLICATE_SET_H
+#include "address/icao_address.h"
+#include <ns3/nstime.h>
+#include <cstdint>
+#include <vector>
+
+namespace olsr {
+
+/**
+ * A set of recently seen (originator, sequence number) pairs of flooded
+ * messages, used to process and forward each message only once
+ * (the duplicate set in RFC 3626 section 3.4)
+ *
+ * Entries are stored in a fixed-size ring buffer in the order they were
+ * added. All entries have the same hold time, so the oldest entry is always
+ * the next to expire. An open-addressing hash table of ring positions
+ * makes lookups constant-time. If the ring is full of entries that have
+ * not expired, it doubles in size up to a maximum capacity. Only after
+ * that is the oldest entry dropped before it expires, and these drops are
+ * counted.
+ */
+class DuplicateSet {
+private:
+    /** An entry in the ring buffer */
+    struct Record {
+        /** Originator address in the high 24 bits, sequence number in the low 8 bits */
+        std::uint32_t key;
+        /** The time when this entry expires */
+        ns3::Time expires;
+    };
+
+    /** Entries, oldest at _head */
+    std::vector<Record> _ring;
+    /** Index in _ring of the oldest entry */
+    std::size_t _head;
+    /** Number of entries */
+    std::size_t _count;
+    /**
+     * Hash table: each slot is 0 if empty, or 1 + the index in _ring of an
+     * entry. The size is a power of two.
+     */
+    std::vector<std::uint32_t> _slots;
+    /** Time to keep entries */
+    ns3::Time _hold_time;
+    /** Capacity of a new or cleared set */
+    std::size_t _initial_capacity;
+    /** Largest capacity that the ring can grow to */
+    std::size_t _max_capacity;
+    /** Number of entries dropped before they expired */
+    std::uint64_t _live_evictions;
+
+    /** Returns the index in _slots of the entry with a key, or _slots.size() if none */
+    std::size_t FindSlot(std::uint32_t key) const;
+    /** Returns the preferred index in _slots for a key */
+    std::size_t HomeSlot(std::uint32_t key) const;
+    /** Removes the slot at an index, moving later entries in its probe sequence back */
+    void RemoveSlot(std::size_t slot);
+    /** Removes the oldest entry */
+    void RemoveOldest();
+    /** Removes entries that have expired */
+    void RemoveExpired();
+    /** Replaces the ring and hash table with empty ones of a capacity */
+    void Allocate(std::size_t capacity);
+    /** Doubles the capacity, keeping all entries */
+    void Grow();
+
+public:
+    /**
+     * Creates an empty duplicate set
+     *
+     * @param hold_time the time to remember each message
+     * @param capacity the initial number of messages that can be remembered
+     * @param max_capacity the largest number of messages to remember
+     */
+    DuplicateSet(ns3::Time hold_time = ns3::Seconds(30), std::size_t capacity = 256, std::size_t max_capacity = 65536);
+
+    /**
+     * Adds a message to this set
+     *
+     * Returns true if the message was added, or false if it is already in
+     * this set (and is therefore a duplicate)
+     */
+    bool Insert(IcaoAddress originator, std::uint8_t sequence);
+
+    /** Returns the number of messages that have not expired */
+    std::size_t size();
+    /** Removes all messages and returns to the initial capacity */
+    void clear();
+    /** Returns the number of messages that can be remembered without growing */
+    inline std::size_t capacity() const {
+        return _ring.size();
+    }
+    /**
+     * Returns the number of messages that were forgotten before their hold
+     * time because the set was at its maximum capacity
+     */
+    inline std::uint64_t LiveEvictions() const {
+        return _live_evictions;
+    }
+};
+
+}
+
+#endif
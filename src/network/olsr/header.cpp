@@ -1,9 +1,46 @@
 #include "header.h"
 #include "util/bits.h"
 #include "util/print_container.h"
+#include <cassert>
+#include <initializer_list>
+#include <stdexcept>
 
 namespace olsr {
 
+namespace {
+
+/** The bit in the type of a message that indicates an extension */
+const std::uint8_t extension_bit = 0x80;
+/** The bit in the type of a topology control message that indicates a gateway */
+const std::uint8_t gateway_bit = 0x40;
+/** The bit in the type of a topology control message that indicates cluster information */
+const std::uint8_t cluster_bit = 0x20;
+
+/**
+ * Calls a function with the address and 2-bit status of each entry in a
+ * compact Hello message, in increasing address order
+ *
+ * Removed neighbors have status 0.
+ */
+template <typename F>
+void for_each_hello_entry(const Message& message, F function) {
+    const auto& neighbors = message.Neighbors();
+    const auto& removed = message.HelloFields().Removed();
+    auto in_neighbors = neighbors.begin();
+    auto in_removed = removed.begin();
+    while (in_neighbors != neighbors.end() || in_removed != removed.end()) {
+        if (in_removed == removed.end() || (in_neighbors != neighbors.end() && in_neighbors->first < *in_removed)) {
+            function(in_neighbors->first, static_cast<std::uint8_t>(in_neighbors->second.State()));
+            ++in_neighbors;
+        } else {
+            function(*in_removed, std::uint8_t(0));
+            ++in_removed;
+        }
+    }
+}
+
+}
+
 Header::Header(const Message& message):
     _message(message)
 {
@@ -40,7 +77,8 @@ void Header::Print(std::ostream& os) const {
         break;
     case MessageType::TopologyControl:
         os << ", Topology control originating at "
-            << _message.Originator() << ", sequence "
+            << _message.Originator() << (_message.IsGateway() ? " (gateway)" : "") << ", hop count "
+            << std::dec << static_cast<unsigned int>(_message.HopCount()) << ", sequence "
             << std::dec << _message.MprSelector().Sequence()
             << ", MPR selector " << print_container::print(_message.MprSelector());
         break;
@@ -53,31 +91,54 @@ std::uint32_t Header::Deserialize(ns3::Buffer::Iterator start) {
     const auto ttl = start.ReadU8();
     _message.SetTtl(ttl);
     const auto type_key = start.ReadU8();
-    switch (type_key) {
+    std::uint32_t size;
+    switch (type_key & ~(extension_bit | gateway_bit | cluster_bit)) {
     case 1:
         _message.SetType(MessageType::Hello);
-        return 2 + DeserializeHello(start);
+        size = DeserializeHello(start);
+        break;
     case 2:
         _message.SetType(MessageType::TopologyControl);
-        return 2 + DeserializeTopologyControl(start);
+        size = DeserializeTopologyControl(start);
+        _message.SetGateway((type_key & gateway_bit) != 0);
+        if ((type_key & cluster_bit) != 0) {
+            auto cluster_start = start;
+            cluster_start.Next(size);
+            size += DeserializeCluster(cluster_start);
+        }
+        break;
     case 3:
         _message.SetType(MessageType::Data);
-        return 2 + DeserializeData(start);
+        size = DeserializeData(start);
+        break;
+    case 4:
+        _message.SetType(MessageType::Hello);
+        size = DeserializeCompactHello(start);
+        break;
     case 0:
         _message.SetType(MessageType::None);
         // Nothing else
-        return 2;
+        size = 0;
+        break;
     default:
         throw std::runtime_error("Invalid message type");
     }
+    if ((type_key & extension_bit) != 0) {
+        start.Next(size);
+        size += DeserializeExtension(start);
+    }
+    return 2 + size;
 }
 
 std::uint32_t Header::GetSerializedSize() const {
     switch (_message.Type()) {
     case MessageType::Hello:
-        return 1 + 1 + 2 + 4 * _message.Neighbors().size();
+        if (_message.HelloFields().Compact()) {
+            return 1 + 1 + CompactHelloSize() + ExtensionSize();
+        }
+        return 1 + 1 + 2 + 4 * _message.Neighbors().size() + ExtensionSize();
     case MessageType::TopologyControl:
-        return 1 + 1 + 3 + 1 + 2 + 3 * _message.MprSelector().size();
+        return 1 + 1 + 3 + 1 + 1 + 2 + 3 * _message.MprSelector().size() + ClusterSize() + ExtensionSize();
     case MessageType::Data:
         return 1 + 1 + 3 + 3 + 2;
     case MessageType::None:
@@ -88,10 +149,20 @@ std::uint32_t Header::GetSerializedSize() const {
 }
 
 void Header::Serialize(ns3::Buffer::Iterator start) const {
+    const auto extension_size = ExtensionSize();
+    if (extension_size != 0) {
+        auto extension_start = start;
+        extension_start.Next(GetSerializedSize() - extension_size);
+        SerializeExtension(extension_start);
+    }
     start.WriteU8(_message.Ttl());
     switch (_message.Type()) {
     case MessageType::Hello:
-        SerializeHello(start);
+        if (_message.HelloFields().Compact()) {
+            SerializeCompactHello(start);
+        } else {
+            SerializeHello(start);
+        }
         break;
     case MessageType::TopologyControl:
         SerializeTopologyControl(start);
@@ -113,7 +184,7 @@ void Header::SerializeNone(ns3::Buffer::Iterator start) const {
 }
 
 void Header::SerializeHello(ns3::Buffer::Iterator start) const {
-    start.WriteU8(1);
+    start.WriteU8(1 | ExtensionFlag());
     start.WriteU16(_message.Neighbors().size());
     for (const auto& entry : _message.Neighbors()) {
         const auto& table_entry = entry.second;
@@ -136,20 +207,105 @@ std::uint32_t Header::DeserializeHello(ns3::Buffer::Iterator after_type) {
     return 2 + 4 * static_cast<std::uint32_t>(neighbor_count);
 }
 
+void Header::SerializeCompactHello(ns3::Buffer::Iterator start) const {
+    start.WriteU8(4 | ExtensionFlag());
+    const auto& fields = _message.HelloFields();
+    start.WriteU8(fields.Sequence());
+    const auto count = static_cast<std::uint32_t>(_message.Neighbors().size() + fields.Removed().size());
+    bits::write_varint(&start, (count << 1) | (fields.Full() ? 1 : 0));
+    // Addresses, then states
+    std::uint32_t previous = 0;
+    for_each_hello_entry(_message, [&](IcaoAddress address, std::uint8_t) {
+        bits::write_varint(&start, address.Value() - previous);
+        previous = address.Value();
+    });
+    std::uint8_t packed = 0;
+    std::uint32_t index = 0;
+    for_each_hello_entry(_message, [&](IcaoAddress, std::uint8_t state) {
+        packed |= state << (2 * (index % 4));
+        index++;
+        if (index % 4 == 0) {
+            start.WriteU8(packed);
+            packed = 0;
+        }
+    });
+    if (index % 4 != 0) {
+        start.WriteU8(packed);
+    }
+}
+
+std::uint32_t Header::CompactHelloSize() const {
+    const auto& fields = _message.HelloFields();
+    const auto count = static_cast<std::uint32_t>(_message.Neighbors().size() + fields.Removed().size());
+    std::uint32_t size = 1 + bits::varint_size((count << 1) | 1) + (count + 3) / 4;
+    std::uint32_t previous = 0;
+    for_each_hello_entry(_message, [&](IcaoAddress address, std::uint8_t) {
+        size += bits::varint_size(address.Value() - previous);
+        previous = address.Value();
+    });
+    return size;
+}
+
+std::uint32_t Header::DeserializeCompactHello(ns3::Buffer::Iterator after_type) {
+    auto& fields = _message.HelloFields();
+    fields.SetCompact(true);
+    fields.SetSequence(after_type.ReadU8());
+    const auto count_and_full = bits::read_varint(&after_type);
+    fields.SetFull((count_and_full & 1) != 0);
+    const auto count = count_and_full >> 1;
+    std::uint32_t size = 1 + bits::varint_size(count_and_full) + (count + 3) / 4;
+
+    std::vector<IcaoAddress> addresses;
+    addresses.reserve(count);
+    std::uint32_t previous = 0;
+    for (std::uint32_t i = 0; i < count; i++) {
+        const auto delta = bits::read_varint(&after_type);
+        size += bits::varint_size(delta);
+        previous += delta;
+        addresses.push_back(IcaoAddress(previous));
+    }
+    std::uint8_t packed = 0;
+    for (std::uint32_t i = 0; i < count; i++) {
+        if (i % 4 == 0) {
+            packed = after_type.ReadU8();
+        }
+        const auto state = (packed >> (2 * (i % 4))) & 0x3;
+        if (state == 0) {
+            fields.Removed().push_back(addresses[i]);
+        } else {
+            // Addresses are in increasing order, so this only appends
+            _message.Neighbors().Insert(NeighborTableEntry(addresses[i], static_cast<LinkState>(state)));
+        }
+    }
+    return size;
+}
+
 void Header::SerializeTopologyControl(ns3::Buffer::Iterator start) const {
-    start.WriteU8(2);
+    const auto& cluster = _message.Cluster();
+    start.WriteU8(2 | ExtensionFlag() | (_message.IsGateway() ? gateway_bit : 0) | (cluster ? cluster_bit : 0));
     const auto& mpr_selector = _message.MprSelector();
     bits::write_u24(&start, _message.Originator().Value());
+    start.WriteU8(_message.HopCount());
     start.WriteU8(mpr_selector.Sequence());
     start.WriteU16(static_cast<std::uint16_t>(mpr_selector.size()));
     for (const auto& entry : mpr_selector) {
         bits::write_u24(&start, entry.second.Address().Value());
     }
+    if (cluster) {
+        assert(cluster->adjacent_cells.size() <= 255);
+        start.WriteU16(cluster->cell);
+        start.WriteU8(cluster->head ? 1 : 0);
+        start.WriteU8(static_cast<std::uint8_t>(cluster->adjacent_cells.size()));
+        for (const auto cell : cluster->adjacent_cells) {
+            start.WriteU16(cell);
+        }
+    }
 }
 
 std::uint32_t Header::DeserializeTopologyControl(ns3::Buffer::Iterator after_type) {
     const auto originator = IcaoAddress(bits::read_u24(&after_type));
     _message.SetOriginator(originator);
+    _message.SetHopCount(after_type.ReadU8());
     auto& mpr_selector = _message.MprSelector();
     mpr_selector.clear();
     const auto sequence = after_type.ReadU8();
@@ -159,7 +315,7 @@ std::uint32_t Header::DeserializeTopologyControl(ns3::Buffer::Iterator after_typ
         const auto address = bits::read_u24(&after_type);
         mpr_selector.Insert(IcaoAddress(address));
     }
-    return 1 + 2 + 3 * static_cast<std::uint32_t>(count);
+    return 3 + 1 + 1 + 2 + 3 * static_cast<std::uint32_t>(count);
 }
 
 void Header::SerializeData(ns3::Buffer::Iterator start) const {
@@ -174,7 +330,134 @@ std::uint32_t Header::DeserializeData(ns3::Buffer::Iterator after_type) {
     _message.SetDestination(IcaoAddress(bits::read_u24(&after_type)));
     const auto length = after_type.ReadU16();
     _message.SetDataLength(length);
-    return 2;
+    return 3 + 3 + 2;
+}
+
+std::uint32_t Header::ClusterSize() const {
+    const auto& cluster = _message.Cluster();
+    return cluster ? 2 + 1 + 1 + 2 * static_cast<std::uint32_t>(cluster->adjacent_cells.size()) : 0;
+}
+
+std::uint32_t Header::DeserializeCluster(ns3::Buffer::Iterator start) {
+    ClusterInfo cluster;
+    cluster.cell = start.ReadU16();
+    cluster.head = (start.ReadU8() & 1) != 0;
+    const auto count = start.ReadU8();
+    cluster.adjacent_cells.reserve(count);
+    for (std::uint8_t i = 0; i < count; i++) {
+        cluster.adjacent_cells.push_back(start.ReadU16());
+    }
+    _message.Cluster() = std::move(cluster);
+    return 2 + 1 + 1 + 2 * static_cast<std::uint32_t>(count);
+}
+
+std::uint8_t Header::ExtensionFlag() const {
+    return ExtensionSize() != 0 ? extension_bit : 0;
+}
+
+std::uint32_t Header::ExtensionSize() const {
+    switch (_message.Type()) {
+    case MessageType::Hello:
+        return _message.HelloFields().SenderMotion() ? 3 * 4 + 3 * 2 : 0;
+    case MessageType::TopologyControl:
+        return static_cast<std::uint32_t>(_message.LinkLifetimes().size());
+    default:
+        return 0;
+    }
+}
+
+void Header::SerializeExtension(ns3::Buffer::Iterator start) const {
+    if (_message.Type() == MessageType::Hello) {
+        const auto& motion = *_message.HelloFields().SenderMotion();
+        for (const auto value : { motion.position.x, motion.position.y, motion.position.z }) {
+            start.WriteU32(static_cast<std::uint32_t>(static_cast<std::int32_t>(value)));
+        }
+        for (const auto value : { motion.velocity.x, motion.velocity.y, motion.velocity.z }) {
+            start.WriteU16(static_cast<std::uint16_t>(static_cast<std::int16_t>(value)));
+        }
+    } else {
+        assert(_message.LinkLifetimes().size() == _message.MprSelector().size());
+        for (const auto lifetime : _message.LinkLifetimes()) {
+            start.WriteU8(lifetime);
+        }
+    }
+}
+
+std::uint32_t Header::DeserializeExtension(ns3::Buffer::Iterator start) {
+    switch (_message.Type()) {
+    case MessageType::Hello: {
+        NodeMotion motion;
+        motion.position.x = static_cast<std::int32_t>(start.ReadU32());
+        motion.position.y = static_cast<std::int32_t>(start.ReadU32());
+        motion.position.z = static_cast<std::int32_t>(start.ReadU32());
+        motion.velocity.x = static_cast<std::int16_t>(start.ReadU16());
+        motion.velocity.y = static_cast<std::int16_t>(start.ReadU16());
+        motion.velocity.z = static_cast<std::int16_t>(start.ReadU16());
+        _message.HelloFields().SetSenderMotion(motion);
+        return 3 * 4 + 3 * 2;
+    }
+    case MessageType::TopologyControl: {
+        auto& lifetimes = _message.LinkLifetimes();
+        lifetimes.resize(_message.MprSelector().size());
+        for (auto& lifetime : lifetimes) {
+            lifetime = start.ReadU8();
+        }
+        return static_cast<std::uint32_t>(lifetimes.size());
+    }
+    default:
+        throw std::runtime_error("Extension on a message type without one");
+    }
+}
+
+DataForwardHeader::DataForwardHeader() :
+    _ttl(0),
+    _type_key(0),
+    _origin(),
+    _destination()
+{
+}
+
+void DataForwardHeader::DecrementTtl() {
+    if (_ttl > 0) {
+        _ttl = _ttl - 1;
+    }
+}
+
+ns3::TypeId DataForwardHeader::GetTypeId() {
+    static ns3::TypeId id = ns3::TypeId("olsr::DataForwardHeader")
+        .SetParent<ns3::Header>()
+        .AddConstructor<DataForwardHeader>();
+    return id;
+}
+
+ns3::TypeId DataForwardHeader::GetInstanceTypeId() const {
+    return GetTypeId();
+}
+
+void DataForwardHeader::Print(std::ostream& os) const {
+    os << "OLSR, TTL " << static_cast<unsigned int>(_ttl) << ", type " << static_cast<unsigned int>(_type_key);
+    if (IsData()) {
+        os << ", data " << _origin << " => " << _destination;
+    }
+}
+
+std::uint32_t DataForwardHeader::Deserialize(ns3::Buffer::Iterator start) {
+    _ttl = start.ReadU8();
+    _type_key = start.ReadU8();
+    _origin = IcaoAddress(bits::read_u24(&start));
+    _destination = IcaoAddress(bits::read_u24(&start));
+    return 8;
+}
+
+std::uint32_t DataForwardHeader::GetSerializedSize() const {
+    return 1 + 1 + 3 + 3;
+}
+
+void DataForwardHeader::Serialize(ns3::Buffer::Iterator start) const {
+    start.WriteU8(_ttl);
+    start.WriteU8(_type_key);
+    bits::write_u24(&start, _origin.Value());
+    bits::write_u24(&start, _destination.Value());
 }
 
 
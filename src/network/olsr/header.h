@@ -11,7 +11,8 @@ namespace olsr {
  *
  * Header format:
  * 8-bit time to live
- * 8-bit message type (None = 0, Hello = 1, TopologyControl = 2, Data = 3)
+ * 8-bit message type (None = 0, Hello = 1, TopologyControl = 2, Data = 3,
+ * compact Hello = 4)
  * Message-type-specific data
  *
  * None message data: (empty)
@@ -22,13 +23,48 @@ namespace olsr {
  *     * Address, 3 bytes
  *     * Status, 1 byte (1 = unidirectional, 2 = bidirectional, 3 = multipoint relay)
  *
+ * Compact Hello message data:
+ * * Sequence number, 1 byte
+ * * Number of entries shifted left by 1, plus 1 if the message contains all
+ *   neighbors, variable-length integer
+ * * For each entry, in increasing address order:
+ *     * Address of the first entry, or difference from the address of the
+ *       previous entry, variable-length integer
+ * * Status of each entry, 2 bits, packed four to a byte starting at the least
+ *   significant bits (0 = removed, 1 = unidirectional, 2 = bidirectional,
+ *   3 = multipoint relay)
+ *
+ * Variable-length integers contain 7 bits in each byte, least significant
+ * first, with the high bit set in all bytes except the last.
+ *
  * TopologyControl message data:
  * * Originator address, 3 bytes
+ * * Hop count (number of times forwarded), 1 byte
  * * MPR selector sequence number, 1 byte
- * * Number of MPR selector addresses, 1 byte
+ * * Number of MPR selector addresses, 2 bytes
  * * For each MPR selector:
  *     * Address, 3 bytes
  *
+ * The second-highest bit of the type of a TopologyControl message is set if
+ * its originator is a gateway. If the third-highest bit is set, the
+ * MPR selectors are followed by cluster information:
+ * * Cell of the originator, 2 bytes
+ * * Flags, 1 byte (1 = the originator is a cluster head)
+ * * Number of adjacent cells, 1 byte
+ * * For each adjacent cell:
+ *     * Cell, 2 bytes
+ *
+ * If the high bit of the type of a Hello, compact Hello or TopologyControl
+ * message is set, the message data is followed by an extension for the
+ * link lifetime metric.
+ *
+ * Hello and compact Hello extension: position of the sender, 3 signed
+ * 4-byte integers in meters, then velocity of the sender, 3 signed 2-byte
+ * integers in meters per second (ECEF x, y, z)
+ *
+ * TopologyControl extension: for each MPR selector, the predicted remaining
+ * lifetime of the link to it, in minutes up to 255, 1 byte
+ *
  * Data message data:
  * * Origin address, 3 bytes
  * * Destination address, 3 bytes
@@ -57,14 +93,74 @@ private:
 
     void SerializeNone(ns3::Buffer::Iterator start) const;
     void SerializeHello(ns3::Buffer::Iterator start) const;
+    void SerializeCompactHello(ns3::Buffer::Iterator start) const;
+    /** Returns the serialized size of a compact Hello, after the TTL and type */
+    std::uint32_t CompactHelloSize() const;
     void SerializeTopologyControl(ns3::Buffer::Iterator start) const;
     void SerializeData(ns3::Buffer::Iterator start) const;
+    /** Returns the high bit to set in the type if the message has an extension */
+    std::uint8_t ExtensionFlag() const;
+    /** Returns the size of the extension, or 0 if there is none */
+    std::uint32_t ExtensionSize() const;
+    void SerializeExtension(ns3::Buffer::Iterator start) const;
+    /** Reads the extension of a message whose other fields have been read */
+    std::uint32_t DeserializeExtension(ns3::Buffer::Iterator start);
+    /** Returns the size of the cluster information, or 0 if there is none */
+    std::uint32_t ClusterSize() const;
+    /** Reads the cluster information of a topology control message */
+    std::uint32_t DeserializeCluster(ns3::Buffer::Iterator start);
 
     std::uint32_t DeserializeHello(ns3::Buffer::Iterator after_type);
+    std::uint32_t DeserializeCompactHello(ns3::Buffer::Iterator after_type);
     std::uint32_t DeserializeTopologyControl(ns3::Buffer::Iterator after_type);
     std::uint32_t DeserializeData(ns3::Buffer::Iterator after_type);
 };
 
+/**
+ * The fields at the start of an OLSR header that are needed to forward a
+ * data message
+ *
+ * Forwarding removes and adds back only these bytes of the header, and
+ * leaves the rest of the packet as it is. It does not build a Message.
+ *
+ * Format: the TTL, type, origin and destination fields of a Header
+ */
+class DataForwardHeader : public ns3::Header {
+public:
+    DataForwardHeader();
+
+    /** Returns true if the header is the start of a data message */
+    inline bool IsData() const {
+        return _type_key == 3;
+    }
+    inline std::uint8_t Ttl() const {
+        return _ttl;
+    }
+    /** Decrements the TTL if it is greater than zero */
+    void DecrementTtl();
+    inline IcaoAddress Origin() const {
+        return _origin;
+    }
+    inline IcaoAddress Destination() const {
+        return _destination;
+    }
+
+    static ns3::TypeId GetTypeId();
+    virtual ns3::TypeId GetInstanceTypeId() const override;
+    virtual void Print(std::ostream& os) const override;
+
+    virtual std::uint32_t Deserialize(ns3::Buffer::Iterator start) override;
+    virtual std::uint32_t GetSerializedSize() const override;
+    virtual void Serialize(ns3::Buffer::Iterator start) const override;
+
+private:
+    std::uint8_t _ttl;
+    /** The message type key, as in Header */
+    std::uint8_t _type_key;
+    IcaoAddress _origin;
+    IcaoAddress _destination;
+};
+
 }
 
 #endif
@@ -3,38 +3,88 @@
 
 namespace olsr {
 
+HelloPayload::HelloPayload() :
+    _neighbors(),
+    _borrowed(nullptr),
+    _compact(false),
+    _full(true),
+    _sequence(0),
+    _removed(),
+    _sender_motion()
+{
+}
+
+HelloPayload::HelloPayload(const NeighborTable& neighbors) :
+    _neighbors(),
+    _borrowed(&neighbors),
+    _compact(false),
+    _full(true),
+    _sequence(0),
+    _removed(),
+    _sender_motion()
+{
+}
+
+NeighborTable& HelloPayload::Neighbors() {
+    if (_borrowed) {
+        _neighbors = *_borrowed;
+        _borrowed = nullptr;
+    }
+    return _neighbors;
+}
+
 Message::Message() :
     Message(MessageType::None, 0)
 {
 }
 
 Message::Message(MessageType type, std::uint8_t ttl) :
-    _type(type),
-    _ttl(ttl)
+    _ttl(ttl),
+    _payload()
 {
+    SetType(type);
 }
 
 Message Message::Data(IcaoAddress origin, IcaoAddress destination, std::uint8_t ttl, std::uint16_t data_length) {
-    Message message(MessageType::Data, ttl);
-    message.SetOrigin(origin);
-    message.SetDestination(destination);
-    message.SetDataLength(data_length);
+    Message message(MessageType::None, ttl);
+    message._payload = DataPayload { origin, destination, data_length };
+    return message;
+}
+
+Message Message::Hello(const NeighborTable& neighbors) {
+    Message message;
+    message._payload = HelloPayload(neighbors);
     return message;
 }
 
 MessageType Message::Type() const {
-    return _type;
+    return static_cast<MessageType>(_payload.which());
 }
 
 void Message::SetType(MessageType type) {
-    _type = type;
+    switch (type) {
+    case MessageType::None:
+        _payload = boost::blank();
+        break;
+    case MessageType::Hello:
+        _payload = HelloPayload();
+        break;
+    case MessageType::TopologyControl:
+        _payload = TopologyControlPayload { IcaoAddress(), 0, false, MprTable(), std::vector<std::uint8_t>(), boost::none };
+        break;
+    case MessageType::Data:
+        _payload = DataPayload { IcaoAddress(), IcaoAddress(), 0 };
+        break;
+    default:
+        throw std::runtime_error("Invalid message type");
+    }
 }
 
 NeighborTable& Message::Neighbors() {
-    return _neighbors;
+    return boost::get<HelloPayload>(_payload).Neighbors();
 }
 const NeighborTable& Message::Neighbors() const {
-    return _neighbors;
+    return boost::get<HelloPayload>(_payload).Neighbors();
 }
 
 void Message::DecrementTtl() {
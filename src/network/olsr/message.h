@@ -4,6 +4,9 @@
 #include "address/icao_address.h"
 #include "neighbor_table.h"
 #include "mpr_table.h"
+#include <ns3/vector.h>
+#include <boost/optional.hpp>
+#include <boost/variant.hpp>
 #include <vector>
 
 namespace olsr {
@@ -20,35 +23,197 @@ enum class MessageType {
     Data,
 };
 
+/** The position and velocity of a node, in ECEF coordinates */
+struct NodeMotion {
+    /** Position, meters */
+    ns3::Vector position;
+    /** Velocity, meters per second */
+    ns3::Vector velocity;
+};
+
+/** Contents of a Hello message */
+class HelloPayload {
+private:
+    /** Neighbors owned by this message, used when it has been received */
+    NeighborTable _neighbors;
+    /**
+     * If not NULL, the neighbor table of the sender, used instead of
+     * _neighbors so that sending a Hello does not copy the table
+     */
+    const NeighborTable* _borrowed;
+    /** If true, this message is serialized in the compact format */
+    bool _compact;
+    /**
+     * If true, the neighbors are all neighbors of the sender. Otherwise,
+     * they are the neighbors that were added or changed since the previous
+     * Hello. Only compact Hellos can be partial.
+     */
+    bool _full;
+    /** Sequence number, used to detect missing partial Hellos */
+    std::uint8_t _sequence;
+    /** Neighbors removed since the previous Hello, in increasing order */
+    std::vector<IcaoAddress> _removed;
+    /** The motion of the sender, if it uses the link lifetime metric */
+    boost::optional<NodeMotion> _sender_motion;
+public:
+    HelloPayload();
+    /** Creates a payload that refers to a table that will outlive it */
+    explicit HelloPayload(const NeighborTable& neighbors);
+
+    inline const NeighborTable& Neighbors() const {
+        return _borrowed ? *_borrowed : _neighbors;
+    }
+    /** Returns the owned neighbor table, copying a borrowed table first */
+    NeighborTable& Neighbors();
+
+    inline bool Compact() const {
+        return _compact;
+    }
+    inline void SetCompact(bool compact) {
+        _compact = compact;
+    }
+    inline bool Full() const {
+        return _full;
+    }
+    inline void SetFull(bool full) {
+        _full = full;
+    }
+    inline std::uint8_t Sequence() const {
+        return _sequence;
+    }
+    inline void SetSequence(std::uint8_t sequence) {
+        _sequence = sequence;
+    }
+    inline std::vector<IcaoAddress>& Removed() {
+        return _removed;
+    }
+    inline const std::vector<IcaoAddress>& Removed() const {
+        return _removed;
+    }
+    inline const boost::optional<NodeMotion>& SenderMotion() const {
+        return _sender_motion;
+    }
+    inline void SetSenderMotion(const boost::optional<NodeMotion>& motion) {
+        _sender_motion = motion;
+    }
+};
+
+/** Cluster information in a topology control message */
+struct ClusterInfo {
+    /** The cell of the originator */
+    std::uint16_t cell;
+    /** True if the originator is the head of its cluster */
+    bool head;
+    /**
+     * Cells next to the cell of the originator, in increasing order: the
+     * cells of its neighbors, or for a head the cells of the neighbors of
+     * all members
+     */
+    std::vector<std::uint16_t> adjacent_cells;
+};
+
+/** Contents of a topology control message */
+struct TopologyControlPayload {
+    /** Originator address */
+    IcaoAddress originator;
+    /** Number of times this message has been forwarded */
+    std::uint8_t hop_count;
+    /** True if the originator is a gateway */
+    bool gateway;
+    /** MPR selector table */
+    MprTable mpr_selector;
+    /**
+     * Predicted remaining lifetime of the link to each MPR selector, in
+     * minutes up to 255, in the order of mpr_selector, or empty if the
+     * originator does not use the link lifetime metric
+     */
+    std::vector<std::uint8_t> link_lifetimes;
+    /** Cluster information, if the originator uses clustered routing */
+    boost::optional<ClusterInfo> cluster;
+};
+
+/** Contents of a data message */
+struct DataPayload {
+    /** Sender address */
+    IcaoAddress origin;
+    /** Destination address */
+    IcaoAddress destination;
+    /** Length of data, bytes */
+    std::uint16_t data_length;
+};
+
 /**
  * Message tagged union
+ *
+ * Only the fields for the type of the message are stored. Calling an
+ * accessor for fields of another type throws boost::bad_get.
  */
 class Message {
 public:
     /** Creates an empty message */
     Message();
-    /** Creates a message with the provided type */
+    /** Creates a message with the provided type and empty or zero fields */
     Message(MessageType type, std::uint8_t ttl = 0);
 
     /** Convenience constructor for a Data message */
     static Message Data(IcaoAddress origin, IcaoAddress destination, std::uint8_t ttl, std::uint16_t data_length);
+    /**
+     * Convenience constructor for a Hello message
+     *
+     * The neighbor table is not copied, so it must not change or be
+     * destroyed while the message exists. A Header containing the message
+     * can be added to a packet, which serializes it immediately.
+     */
+    static Message Hello(const NeighborTable& neighbors);
 
     MessageType Type() const;
+    /** Sets the type of this message, and replaces its fields with empty or zero fields */
     void SetType(MessageType type);
 
     NeighborTable& Neighbors();
     const NeighborTable& Neighbors() const;
+    /** Returns the Hello-specific fields other than the neighbors */
+    inline HelloPayload& HelloFields() {
+        return boost::get<HelloPayload>(_payload);
+    }
+    inline const HelloPayload& HelloFields() const {
+        return boost::get<HelloPayload>(_payload);
+    }
     inline MprTable& MprSelector() {
-        return _mpr_selector;
+        return boost::get<TopologyControlPayload>(_payload).mpr_selector;
     }
     inline const MprTable& MprSelector() const {
-        return _mpr_selector;
+        return boost::get<TopologyControlPayload>(_payload).mpr_selector;
+    }
+    inline std::vector<std::uint8_t>& LinkLifetimes() {
+        return boost::get<TopologyControlPayload>(_payload).link_lifetimes;
+    }
+    inline const std::vector<std::uint8_t>& LinkLifetimes() const {
+        return boost::get<TopologyControlPayload>(_payload).link_lifetimes;
     }
     inline IcaoAddress Originator() const {
-        return _originator;
+        return boost::get<TopologyControlPayload>(_payload).originator;
     }
     inline void SetOriginator(IcaoAddress originator) {
-        _originator = originator;
+        boost::get<TopologyControlPayload>(_payload).originator = originator;
+    }
+    inline std::uint8_t HopCount() const {
+        return boost::get<TopologyControlPayload>(_payload).hop_count;
+    }
+    inline void SetHopCount(std::uint8_t hop_count) {
+        boost::get<TopologyControlPayload>(_payload).hop_count = hop_count;
+    }
+    inline bool IsGateway() const {
+        return boost::get<TopologyControlPayload>(_payload).gateway;
+    }
+    inline void SetGateway(bool gateway) {
+        boost::get<TopologyControlPayload>(_payload).gateway = gateway;
+    }
+    inline boost::optional<ClusterInfo>& Cluster() {
+        return boost::get<TopologyControlPayload>(_payload).cluster;
+    }
+    inline const boost::optional<ClusterInfo>& Cluster() const {
+        return boost::get<TopologyControlPayload>(_payload).cluster;
     }
     inline std::uint8_t Ttl() const {
         return _ttl;
@@ -60,44 +225,33 @@ public:
     void DecrementTtl();
 
     IcaoAddress Origin() const {
-        return _origin;
+        return boost::get<DataPayload>(_payload).origin;
     }
     void SetOrigin(IcaoAddress origin) {
-        _origin = origin;
+        boost::get<DataPayload>(_payload).origin = origin;
     }
     IcaoAddress Destination() const {
-        return _destination;
+        return boost::get<DataPayload>(_payload).destination;
     }
     void SetDestination(IcaoAddress destination) {
-        _destination = destination;
+        boost::get<DataPayload>(_payload).destination = destination;
     }
     std::uint16_t DataLength() const {
-        return _data_length;
+        return boost::get<DataPayload>(_payload).data_length;
     }
     void SetDataLength(std::uint16_t data_length) {
-        _data_length = data_length;
+        boost::get<DataPayload>(_payload).data_length = data_length;
     }
 private:
-    MessageType _type;
     /** Time to live */
     std::uint8_t _ttl;
-
-    // Hello message
-    /** Neighbors (used for Hello messages) */
-    NeighborTable _neighbors;
-    // TopologyControl message
-    /** Originator address */
-    IcaoAddress _originator;
-    /** MPR selector table */
-    MprTable _mpr_selector;
-
-    // Data message
-    /** Sender address */
-    IcaoAddress _origin;
-    /** Destination address */
-    IcaoAddress _destination;
-    /** Length of data, bytes */
-    std::uint16_t _data_length;
+    /**
+     * Type-specific fields
+     *
+     * The index of the payload type is the same as the value of the
+     * MessageType.
+     */
+    boost::variant<boost::blank, HelloPayload, TopologyControlPayload, DataPayload> _payload;
 };
 
 }
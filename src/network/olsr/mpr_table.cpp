@@ -1,5 +1,7 @@
 #include "mpr_table.h"
 #include <ns3/simulator.h>
+#include <algorithm>
+#include <vector>
 
 namespace olsr {
 
@@ -32,29 +34,34 @@ MprTable::MprTable(ns3::Time ttl) :
 }
 
 void MprTable::Insert(IcaoAddress address) {
-    _table.insert(std::make_pair(address, Entry(address)));
+    const auto inserted = _table.insert(std::make_pair(address, Entry(address)));
+    if (inserted.second && _ttl.IsStrictlyPositive()) {
+        _expiry.Push(address, inserted.first->second.LastUpdated());
+    }
 }
 
 void MprTable::clear() {
     _table.clear();
+    _expiry.clear();
 }
 
 void MprTable::RemoveExpired() {
-    const auto now = ns3::Simulator::Now();
-    auto any_removed = false;
-    for (auto iter = _table.begin(); iter != _table.end(); /* nothing */) {
-        const auto updated = iter->second.LastUpdated();
-        if (now - updated > _ttl) {
-            // Remove
-            const auto to_remove = iter;
-            ++iter;
-            _table.erase(to_remove);
-            any_removed = true;
+    const auto cutoff = ns3::Simulator::Now() - _ttl;
+    std::vector<IcaoAddress> expired;
+    _expiry.PopBefore(cutoff, [&](IcaoAddress address) {
+        const auto entry = _table.find(address);
+        if (entry == _table.end()) {
+            return;
+        }
+        if (entry->second.LastUpdated() < cutoff) {
+            expired.push_back(address);
         } else {
-            ++iter;
+            _expiry.Push(address, entry->second.LastUpdated());
         }
-    }
-    if (any_removed) {
+    });
+    if (!expired.empty()) {
+        std::sort(expired.begin(), expired.end());
+        _table.erase_keys(expired.begin(), expired.end());
         IncrementSequence();
     }
 }
@@ -2,7 +2,8 @@
 #define NETWORK_OLSR_MPR_TABLE_H
 #include <ns3/nstime.h>
 #include "address/icao_address.h"
-#include <map>
+#include "util/flat_map.h"
+#include "util/expiry_queue.h"
 #include <ostream>
 
 namespace olsr {
@@ -31,17 +32,26 @@ public:
     };
 
 private:
-    /** Table of entries */
-    std::map<IcaoAddress, Entry> _table;
+    /** Table of entries, sorted by address */
+    util::FlatMap<IcaoAddress, Entry> _table;
     /** Sequence number, updated on modification */
     std::uint8_t _sequence;
     /** Maximum time to keep entries after last seen */
     ns3::Time _ttl;
+    /** Addresses of entries in the order they may expire */
+    util::ExpiryQueue<IcaoAddress> _expiry;
 
 public:
-    typedef std::map<IcaoAddress, Entry>::iterator iterator;
-    typedef std::map<IcaoAddress, Entry>::const_iterator const_iterator;
+    typedef util::FlatMap<IcaoAddress, Entry>::iterator iterator;
+    typedef util::FlatMap<IcaoAddress, Entry>::const_iterator const_iterator;
 
+    /**
+     * Creates a table
+     *
+     * A table with a zero TTL, like the table in a topology control
+     * message, does not keep track of expiry, and RemoveExpired() does
+     * nothing.
+     */
     MprTable(ns3::Time ttl = ns3::Time());
 
     inline std::size_t size() const {
@@ -1,11 +1,11 @@
 #include "multipoint_relay.h"
-#include "util/print_container.h"
 #include <ns3/log.h>
 #include <cassert>
+#include <cstdint>
 #include <vector>
-#include <set>
+#include <bitset>
 #include <algorithm>
-#include <functional>
+#include <initializer_list>
 
 namespace olsr {
 
@@ -13,60 +13,167 @@ NS_LOG_COMPONENT_DEFINE("olsr::multipoint_relay");
 
 namespace {
 
-bool compare_two_hop_neighbors(const NeighborTableEntry& e1, const NeighborTableEntry& e2) {
-    return e1.TwoHopNeighbors().size() > e2.TwoHopNeighbors().size();
+bool is_symmetric(const NeighborTableEntry& entry) {
+    const auto state = entry.State();
+    return state == LinkState::Bidirectional || state == LinkState::MultiPointRelay;
 }
 
+/** Returns the number of bits set in a word */
+inline std::size_t count_bits(std::uint64_t word) {
+    return std::bitset<64>(word).count();
 }
 
-void update_multipoint_relay(NeighborTable* table) {
+}
+
+void update_multipoint_relay(NeighborTable* table, ns3::Time preferred_until) {
     NS_LOG_FUNCTION(table);
     assert(table);
-    // General idea:
-    // Choose a subset of bidirectional neighbors that provide access
-    // to all 2-hop neighbors
-
-    // Heuristic: Sort from most to least 2-hop neighbors, add to the subset
-    // until no more 2-hop neighbors get added
-
-    // Part 1: Collect bidirectional or MPR neighbors
-    std::vector<std::reference_wrapper<const NeighborTableEntry>> bidir_neighbors;
-    bidir_neighbors.reserve(table->size());
-    for (const auto& entry : *table) {
-        const auto& table_entry = entry.second;
-        const auto state = table_entry.State();
-        if (state == LinkState::Bidirectional || state == LinkState::MultiPointRelay) {
-            bidir_neighbors.push_back(table_entry);
+    // General idea (RFC 3626 section 8.3.1):
+    // Choose a small subset of symmetric neighbors that provides access
+    // to all strict 2-hop neighbors (2-hop neighbors that are not also
+    // symmetric neighbors)
+
+    // Part 1: Collect symmetric neighbors
+    std::vector<NeighborTableEntry*> neighbors;
+    neighbors.reserve(table->size());
+    for (auto& entry : *table) {
+        if (is_symmetric(entry.second)) {
+            neighbors.push_back(&entry.second);
         }
     }
-    // Part 2: Sort by number of 2-hop neighbors, greatest to least
-    std::sort(bidir_neighbors.begin(), bidir_neighbors.end(), compare_two_hop_neighbors);
-    NS_LOG_LOGIC("Bidirectional neighbors sorted: " << print_container::print(bidir_neighbors));
-
-    std::set<IcaoAddress> two_hop_neighbors;
-    std::set<IcaoAddress> multipoint_relay;
-    for (const NeighborTableEntry& neighbor : bidir_neighbors) {
-        const auto initial_size = two_hop_neighbors.size();
-        two_hop_neighbors.insert(neighbor.TwoHopNeighbors().begin(), neighbor.TwoHopNeighbors().end());
-        const auto new_size = two_hop_neighbors.size();
-        // Make this neighbor a multipoint relay if it added a new 2-hop neighbor
-        if (initial_size != new_size) {
-            multipoint_relay.insert(neighbor.Address());
+
+    // Part 2: Give each strict 2-hop neighbor a dense index, and find the
+    // symmetric neighbors that reach it from the table index
+    // Neighbors are in address order, like all 2-hop neighbor sets
+    std::vector<IcaoAddress> symmetric_addresses;
+    symmetric_addresses.reserve(neighbors.size());
+    for (const auto* neighbor : neighbors) {
+        symmetric_addresses.push_back(neighbor->Address());
+    }
+    const auto symmetric_index = [&](IcaoAddress address) {
+        const auto position = std::lower_bound(symmetric_addresses.begin(), symmetric_addresses.end(), address);
+        return (position != symmetric_addresses.end() && *position == address)
+            ? static_cast<std::size_t>(position - symmetric_addresses.begin())
+            : neighbors.size();
+    };
+    std::size_t two_hop_count = 0;
+    // (2-hop neighbor index, symmetric neighbor index) pairs
+    std::vector<std::pair<std::size_t, std::size_t>> reaches;
+    // For each 2-hop neighbor, the number of symmetric neighbors that reach it
+    // and the last of them
+    std::vector<std::pair<std::uint32_t, std::size_t>> reached_by;
+    for (const auto& entry : table->TwoHopIndex()) {
+        if (symmetric_index(entry.first) != neighbors.size()) {
+            // Not a strict 2-hop neighbor
+            continue;
+        }
+        std::pair<std::uint32_t, std::size_t> count(0, 0);
+        for (const auto& address : entry.second) {
+            const auto i = symmetric_index(address);
+            if (i != neighbors.size()) {
+                reaches.push_back(std::make_pair(two_hop_count, i));
+                count.first++;
+                count.second = i;
+            }
+        }
+        if (count.first != 0) {
+            reached_by.push_back(count);
+            two_hop_count++;
         }
     }
-    // Update table entries: If bidirectional or multipoint relay,
-    // set to bidirectional or multipoint based on multipoint_relay presence
-    for (auto& entry : *table) {
-        auto& table_entry = entry.second;
-        const auto state = table_entry.State();
-        if (state == LinkState::Bidirectional || state == LinkState::MultiPointRelay) {
-            if (multipoint_relay.find(table_entry.Address()) != multipoint_relay.end()) {
-                table_entry.SetState(LinkState::MultiPointRelay);
-            } else {
-                table_entry.SetState(LinkState::Bidirectional);
+
+    // Part 3: For each neighbor, a bitset of the 2-hop neighbors it covers
+    const std::size_t words = (two_hop_count + 63) / 64;
+    std::vector<std::uint64_t> covers(neighbors.size() * words, 0);
+    for (const auto& pair : reaches) {
+        covers[pair.second * words + pair.first / 64] |= std::uint64_t(1) << (pair.first % 64);
+    }
+
+    std::vector<std::uint64_t> uncovered(words, ~std::uint64_t(0));
+    if (two_hop_count % 64 != 0) {
+        uncovered.back() = (std::uint64_t(1) << (two_hop_count % 64)) - 1;
+    }
+    std::vector<bool> selected(neighbors.size(), false);
+    const auto select = [&](std::size_t i) {
+        selected[i] = true;
+        for (std::size_t w = 0; w < words; w++) {
+            uncovered[w] &= ~covers[i * words + w];
+        }
+    };
+
+    // Part 4: Neighbors that are the only route to some 2-hop neighbor
+    for (const auto& count : reached_by) {
+        if (count.first == 1 && !selected[count.second]) {
+            select(count.second);
+        }
+    }
+
+    // Part 5: Repeatedly select the neighbor that covers the most uncovered
+    // 2-hop neighbors, preferring links that last longer and then neighbors
+    // with more 2-hop neighbors. The first pass uses only links that last
+    // until preferred_until.
+    for (const auto long_lived_only : { true, false }) {
+        while (true) {
+            std::size_t best = neighbors.size();
+            std::size_t best_new = 0;
+            for (std::size_t i = 0; i < neighbors.size(); i++) {
+                if (selected[i] || (long_lived_only && neighbors[i]->LinkExpires() < preferred_until)) {
+                    continue;
+                }
+                std::size_t new_count = 0;
+                for (std::size_t w = 0; w < words; w++) {
+                    new_count += count_bits(covers[i * words + w] & uncovered[w]);
+                }
+                if (new_count > best_new
+                    || (new_count == best_new && new_count != 0
+                        && (neighbors[i]->LinkExpires() > neighbors[best]->LinkExpires()
+                            || (neighbors[i]->LinkExpires() == neighbors[best]->LinkExpires()
+                                && neighbors[i]->TwoHopNeighbors().size() > neighbors[best]->TwoHopNeighbors().size())))) {
+                    best = i;
+                    best_new = new_count;
+                }
+            }
+            if (best == neighbors.size()) {
+                break;
             }
+            NS_LOG_LOGIC("Selecting " << neighbors[best]->Address() << ", covers " << best_new << " more 2-hop neighbors");
+            select(best);
+        }
+    }
+
+    // Part 6: Update table entries
+    for (std::size_t i = 0; i < neighbors.size(); i++) {
+        const auto state = selected[i] ? LinkState::MultiPointRelay : LinkState::Bidirectional;
+        if (neighbors[i]->State() != state) {
+            neighbors[i]->SetRelayState(state);
+        }
+    }
+}
+
+bool relay_uncovered(const NeighborTable& table, IcaoAddress two_hop) {
+    const auto in_table = table.Find(two_hop);
+    if (in_table != table.end() && is_symmetric(in_table->second)) {
+        // Not a strict 2-hop neighbor
+        return false;
+    }
+    auto reached = false;
+    for (const auto& address : table.NeighborsReaching(two_hop)) {
+        const auto& neighbor = table.Find(address)->second;
+        if (neighbor.State() == LinkState::MultiPointRelay) {
+            return false;
+        }
+        reached = reached || is_symmetric(neighbor);
+    }
+    return reached;
+}
+
+bool relays_uncovered(const NeighborTable& table, const NeighborTableEntry::two_hop_set& two_hop_neighbors) {
+    for (const auto& address : two_hop_neighbors) {
+        if (relay_uncovered(table, address)) {
+            return true;
         }
     }
+    return false;
 }
 
 }
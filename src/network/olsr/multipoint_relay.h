@@ -7,9 +7,31 @@ namespace olsr {
 /**
  * Updates the multipoint relay set in a neighbor table
  *
+ * Uses the greedy heuristic from RFC 3626 section 8.3.1: first select
+ * neighbors that are the only way to reach some strict 2-hop neighbor,
+ * then repeatedly select the neighbor that reaches the most 2-hop neighbors
+ * that are not yet covered.
+ *
+ * The greedy step first considers only neighbors whose links are predicted
+ * to last until preferred_until, and then all neighbors. Ties go to the
+ * link predicted to last longer.
+ *
  * @param table a non-NULL pointer to a neighbor table
+ * @param preferred_until the time until which preferred links must last
+ */
+void update_multipoint_relay(NeighborTable* table, ns3::Time preferred_until = ns3::Time());
+
+/**
+ * Returns true if a strict 2-hop neighbor is reached through some symmetric
+ * neighbor but not through any multipoint relay
+ *
+ * The multipoint relay set only needs to be selected again when this is
+ * true for some 2-hop neighbor whose neighbors have changed. This looks up
+ * the neighbors that reach the 2-hop neighbor in the table index.
  */
-void update_multipoint_relay(NeighborTable* table);
+bool relay_uncovered(const NeighborTable& table, IcaoAddress two_hop);
+/** Returns true if relay_uncovered() is true for any of some 2-hop neighbors */
+bool relays_uncovered(const NeighborTable& table, const NeighborTableEntry::two_hop_set& two_hop_neighbors);
 
 }
 
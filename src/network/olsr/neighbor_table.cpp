@@ -1,6 +1,7 @@
 #include "neighbor_table.h"
 #include <ns3/simulator.h>
 #include <ns3/log.h>
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE("olsr::NeighborTable");
 
@@ -11,7 +12,8 @@ namespace olsr {
 NeighborTableEntry::NeighborTableEntry(IcaoAddress address, LinkState state) :
     _address(address),
     _state(state),
-    _updated(ns3::Simulator::Now())
+    _updated(ns3::Simulator::Now()),
+    _link_expires(ns3::Time::Max())
 {
 }
 
@@ -25,6 +27,9 @@ void NeighborTableEntry::SetState(LinkState state) {
     _state = state;
     _updated = ns3::Simulator::Now();
 }
+void NeighborTableEntry::SetRelayState(LinkState state) {
+    _state = state;
+}
 void NeighborTableEntry::MarkSeen() {
     _updated = ns3::Simulator::Now();
 }
@@ -33,10 +38,10 @@ ns3::Time NeighborTableEntry::LastUpdated () const {
     return _updated;
 }
 
-std::set<IcaoAddress>& NeighborTableEntry::TwoHopNeighbors() {
+NeighborTableEntry::two_hop_set& NeighborTableEntry::TwoHopNeighbors() {
     return _two_hop_neighbors;
 }
-const std::set<IcaoAddress>& NeighborTableEntry::TwoHopNeighbors() const {
+const NeighborTableEntry::two_hop_set& NeighborTableEntry::TwoHopNeighbors() const {
     return _two_hop_neighbors;
 }
 
@@ -47,22 +52,34 @@ NeighborTable::NeighborTable(ns3::Time ttl) :
 {
 }
 
-void NeighborTable::RemoveExpired() {
-    const auto now = ns3::Simulator::Now();
-    for (auto iter = _table.begin(); iter != _table.end(); /* none */) {
-        const auto& table_entry = iter->second;
-        const auto age = now - table_entry.LastUpdated();
-        if (age > _ttl) {
-            // Delete
-            // This invalidates the iterator to the removed element,
-            // but not to other elements
+void NeighborTable::RemoveExpired(std::vector<IcaoAddress>* removed, std::vector<IcaoAddress>* two_hop_removed) {
+    const auto cutoff = ns3::Simulator::Now() - _ttl;
+    std::vector<IcaoAddress> expired;
+    _expiry.PopBefore(cutoff, [&](IcaoAddress address) {
+        const auto entry = _table.find(address);
+        if (entry == _table.end()) {
+            // Already removed
+            return;
+        }
+        const auto& table_entry = entry->second;
+        if (table_entry.LastUpdated() < cutoff) {
             NS_LOG_LOGIC("Deleting expired neighbor " << table_entry);
-            const auto to_remove = iter;
-            iter = ++iter;
-            _table.erase(to_remove);
+            expired.push_back(address);
         } else {
-            iter = ++iter;
+            _expiry.Push(address, table_entry.LastUpdated());
         }
+    });
+    std::sort(expired.begin(), expired.end());
+    for (const auto& address : expired) {
+        const auto& two_hop_neighbors = _table.find(address)->second.TwoHopNeighbors();
+        UnindexTwoHop(address, two_hop_neighbors);
+        if (two_hop_removed) {
+            two_hop_removed->insert(two_hop_removed->end(), two_hop_neighbors.begin(), two_hop_neighbors.end());
+        }
+    }
+    _table.erase_keys(expired.begin(), expired.end());
+    if (removed) {
+        removed->insert(removed->end(), expired.begin(), expired.end());
     }
 }
 
@@ -92,10 +109,52 @@ std::size_t NeighborTable::size() const {
 }
 void NeighborTable::clear() {
     _table.clear();
+    _two_hop_index.clear();
+    _expiry.clear();
 }
 
 void NeighborTable::Insert(const NeighborTableEntry& entry) {
-    _table.insert(std::make_pair(entry.Address(), entry));
+    const auto inserted = _table.insert(std::make_pair(entry.Address(), entry));
+    if (!inserted.second) {
+        return;
+    }
+    IndexTwoHop(entry.Address(), entry.TwoHopNeighbors());
+    if (_ttl.IsStrictlyPositive()) {
+        _expiry.Push(entry.Address(), entry.LastUpdated());
+    }
+}
+
+void NeighborTable::SetTwoHopNeighbors(iterator entry, NeighborTableEntry::two_hop_set& two_hop_neighbors) {
+    auto& table_entry = entry->second;
+    UnindexTwoHop(table_entry.Address(), table_entry.TwoHopNeighbors());
+    std::swap(table_entry.TwoHopNeighbors(), two_hop_neighbors);
+    IndexTwoHop(table_entry.Address(), table_entry.TwoHopNeighbors());
+}
+
+const NeighborTableEntry::two_hop_set& NeighborTable::NeighborsReaching(IcaoAddress two_hop) const {
+    static const NeighborTableEntry::two_hop_set empty;
+    const auto in_index = _two_hop_index.find(two_hop);
+    return in_index != _two_hop_index.end() ? in_index->second : empty;
+}
+
+void NeighborTable::IndexTwoHop(IcaoAddress neighbor, const NeighborTableEntry::two_hop_set& two_hop_neighbors) {
+    for (const auto& address : two_hop_neighbors) {
+        auto in_index = _two_hop_index.insert(std::make_pair(address, NeighborTableEntry::two_hop_set())).first;
+        in_index->second.insert(neighbor);
+    }
+}
+
+void NeighborTable::UnindexTwoHop(IcaoAddress neighbor, const NeighborTableEntry::two_hop_set& two_hop_neighbors) {
+    for (const auto& address : two_hop_neighbors) {
+        auto in_index = _two_hop_index.find(address);
+        if (in_index == _two_hop_index.end()) {
+            continue;
+        }
+        in_index->second.erase(neighbor);
+        if (in_index->second.empty()) {
+            _two_hop_index.erase(in_index);
+        }
+    }
 }
 
 std::set<IcaoAddress> NeighborTable::Neighbors() const {
@@ -142,7 +201,7 @@ std::ostream& operator << (std::ostream& stream, const LinkState& state) {
 std::ostream& operator << (std::ostream& stream, const NeighborTableEntry& entry) {
     return stream << entry.Address() << ':' << entry.State();
 }
-std::ostream& operator << (std::ostream& stream, const std::pair<const IcaoAddress, olsr::NeighborTableEntry>& entry) {
+std::ostream& operator << (std::ostream& stream, const std::pair<IcaoAddress, olsr::NeighborTableEntry>& entry) {
     return stream << entry.second;
 }
 
@@ -1,10 +1,13 @@
 #ifndef NETWORK_OLSR_NEIGHBOR_TABLE_H
 #define NETWORK_OLSR_NEIGHBOR_TABLE_H
-#include <map>
 #include <set>
+#include <vector>
 #include <ostream>
 #include <ns3/nstime.h>
+#include <boost/optional.hpp>
 #include "address/icao_address.h"
+#include "util/flat_map.h"
+#include "util/expiry_queue.h"
 
 namespace olsr {
 
@@ -25,6 +28,9 @@ std::ostream& operator << (std::ostream& stream, const LinkState& state);
  * An entry in a neighbor table
  */
 class NeighborTableEntry {
+public:
+    /** A set of two-hop neighbor addresses */
+    typedef util::FlatSet<IcaoAddress> two_hop_set;
 private:
     /** The neighbor address */
     IcaoAddress _address;
@@ -36,7 +42,23 @@ private:
      * The addresses of two-hop neighbors that can be accessed through this
      * neighbor
      */
-    std::set<IcaoAddress> _two_hop_neighbors;
+    two_hop_set _two_hop_neighbors;
+    /**
+     * The sequence number of the last compact Hello from this neighbor whose
+     * neighbors are all known, if any
+     *
+     * A partial Hello can only be applied if it directly follows this one.
+     */
+    boost::optional<std::uint8_t> _hello_sequence;
+    /** The link state that this neighbor reported for this node, if any */
+    boost::optional<LinkState> _advertised_state;
+    /**
+     * The time when the link to this neighbor is predicted to break, or
+     * ns3::Time::Max() if there is no prediction
+     */
+    ns3::Time _link_expires;
+    /** The cell of this neighbor, if it uses clustered routing */
+    boost::optional<std::uint16_t> _cell;
 public:
     NeighborTableEntry(IcaoAddress address, LinkState state);
     IcaoAddress Address() const;
@@ -44,40 +66,117 @@ public:
     /** Returns the simulation time when this entry was updated */
     ns3::Time LastUpdated() const;
 
-    std::set<IcaoAddress>& TwoHopNeighbors();
-    const std::set<IcaoAddress>& TwoHopNeighbors() const;
+    /**
+     * Returns the 2-hop neighbors of this entry
+     *
+     * The 2-hop neighbors of an entry that is already in a NeighborTable
+     * must be changed with NeighborTable::SetTwoHopNeighbors() so that the
+     * table index stays correct.
+     */
+    two_hop_set& TwoHopNeighbors();
+    const two_hop_set& TwoHopNeighbors() const;
+
+    inline const boost::optional<std::uint8_t>& HelloSequence() const {
+        return _hello_sequence;
+    }
+    inline void SetHelloSequence(const boost::optional<std::uint8_t>& sequence) {
+        _hello_sequence = sequence;
+    }
+    inline const boost::optional<LinkState>& AdvertisedState() const {
+        return _advertised_state;
+    }
+    inline void SetAdvertisedState(const boost::optional<LinkState>& state) {
+        _advertised_state = state;
+    }
+    inline ns3::Time LinkExpires() const {
+        return _link_expires;
+    }
+    inline void SetLinkExpires(ns3::Time expires) {
+        _link_expires = expires;
+    }
+    inline const boost::optional<std::uint16_t>& Cell() const {
+        return _cell;
+    }
+    inline void SetCell(const boost::optional<std::uint16_t>& cell) {
+        _cell = cell;
+    }
 
     /** Sets the link state and marks this entry as updated */
     void SetState(LinkState state);
+    /**
+     * Sets the link state without marking this entry as updated
+     *
+     * This is for multipoint relay selection, which does not mean that the
+     * neighbor has been heard from, so it must not delay the expiry of the
+     * entry.
+     */
+    void SetRelayState(LinkState state);
     /** Marks this entry as updated */
     void MarkSeen();
 
     friend std::ostream& operator << (std::ostream& stream, const NeighborTableEntry& entry);
 };
-std::ostream& operator << (std::ostream& stream, const std::pair<const IcaoAddress, olsr::NeighborTableEntry>& entry);
+std::ostream& operator << (std::ostream& stream, const std::pair<IcaoAddress, olsr::NeighborTableEntry>& entry);
 
 class NeighborTable {
+public:
+    /** 2-hop neighbor address -> addresses of the neighbors that reach it */
+    typedef util::FlatMap<IcaoAddress, NeighborTableEntry::two_hop_set> two_hop_index;
 private:
-    /** The table of entries */
-    std::map<IcaoAddress, NeighborTableEntry> _table;
+    /** The table of entries, sorted by address */
+    util::FlatMap<IcaoAddress, NeighborTableEntry> _table;
+    /** The 2-hop neighbors of all entries, inverted */
+    two_hop_index _two_hop_index;
     /** The time before entries expire */
     ns3::Time _ttl;
+    /** Addresses of entries in the order they may expire */
+    util::ExpiryQueue<IcaoAddress> _expiry;
 public:
+    /**
+     * Creates a table
+     *
+     * A table with a zero TTL, like the table in a Hello message, does not
+     * keep track of expiry, and RemoveExpired() does nothing.
+     */
     NeighborTable(ns3::Time ttl = ns3::Time());
     /**
      * An iterator over pairs, where each pair contains an address and a
      * neighbor table entry
      */
-    typedef std::map<IcaoAddress, NeighborTableEntry>::iterator iterator;
-    typedef std::map<IcaoAddress, NeighborTableEntry>::const_iterator const_iterator;
+    typedef util::FlatMap<IcaoAddress, NeighborTableEntry>::iterator iterator;
+    typedef util::FlatMap<IcaoAddress, NeighborTableEntry>::const_iterator const_iterator;
 
-    /** Removes entries that have expired */
-    void RemoveExpired();
+    /**
+     * Removes entries that have expired
+     *
+     * @param removed if not NULL, the addresses of removed entries are
+     * appended to this vector
+     * @param two_hop_removed if not NULL, the 2-hop neighbors of removed
+     * entries are appended to this vector
+     */
+    void RemoveExpired(std::vector<IcaoAddress>* removed = nullptr, std::vector<IcaoAddress>* two_hop_removed = nullptr);
 
     iterator Find(IcaoAddress address);
     const_iterator Find(IcaoAddress address) const;
     void Insert(const NeighborTableEntry& entry);
 
+    /**
+     * Replaces the 2-hop neighbors of an entry in this table and updates
+     * the index
+     *
+     * On return, two_hop_neighbors contains the previous 2-hop neighbors.
+     */
+    void SetTwoHopNeighbors(iterator entry, NeighborTableEntry::two_hop_set& two_hop_neighbors);
+    /**
+     * Returns the addresses of the neighbors that report a 2-hop neighbor,
+     * in increasing order
+     */
+    const NeighborTableEntry::two_hop_set& NeighborsReaching(IcaoAddress two_hop) const;
+    /** Returns the index from each 2-hop neighbor to the neighbors that report it */
+    inline const two_hop_index& TwoHopIndex() const {
+        return _two_hop_index;
+    }
+
     iterator begin();
     iterator end();
     const_iterator begin() const;
@@ -89,6 +188,11 @@ public:
     std::set<IcaoAddress> Neighbors() const;
     /** Returns the addresses of neighbors with unidirectional links */
     std::set<IcaoAddress> UnidirectionalNeighbors() const;
+
+private:
+    /** Adds or removes a neighbor from the index entries of some 2-hop neighbors */
+    void IndexTwoHop(IcaoAddress neighbor, const NeighborTableEntry::two_hop_set& two_hop_neighbors);
+    void UnindexTwoHop(IcaoAddress neighbor, const NeighborTableEntry::two_hop_set& two_hop_neighbors);
 };
 
 }
@@ -4,10 +4,14 @@
 #include "routing_calc.h"
 #include "util/print_container.h"
 #include "header/mesh_header.h"
+#include "network/batch_runner.h"
 #include "packet_recorder/packet_recorder.h"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <limits>
 #include <ns3/log.h>
+#include <ns3/mobility-model.h>
 #include <ns3/simulator.h>
 
 NS_LOG_COMPONENT_DEFINE("OLSR");
@@ -17,16 +21,78 @@ NS_LOG_COMPONENT_DEFINE("OLSR");
 
 namespace olsr {
 
+namespace {
+
+/**
+ * TTL of messages that should reach every node. Duplicate detection, not
+ * the TTL, stops them.
+ */
+const std::uint8_t flood_ttl = std::numeric_limits<std::uint8_t>::max();
+
+inline double dot(const ns3::Vector& a, const ns3::Vector& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/**
+ * Returns the time until two nodes are farther apart than range, assuming
+ * that their velocities do not change, or ns3::Time::Max() if they never
+ * will be
+ */
+ns3::Time predict_link_lifetime(const NodeMotion& a, const NodeMotion& b, double range) {
+    const auto dp = ns3::Vector(b.position.x - a.position.x, b.position.y - a.position.y, b.position.z - a.position.z);
+    const auto dv = ns3::Vector(b.velocity.x - a.velocity.x, b.velocity.y - a.velocity.y, b.velocity.z - a.velocity.z);
+    // Solve |dp + dv t| = range for the positive t
+    const auto c = dot(dp, dp) - range * range;
+    if (c >= 0) {
+        return ns3::Time();
+    }
+    const auto a2 = dot(dv, dv);
+    if (a2 == 0) {
+        return ns3::Time::Max();
+    }
+    const auto b2 = 2 * dot(dp, dv);
+    return ns3::Seconds((-b2 + std::sqrt(b2 * b2 - 4 * a2 * c)) / (2 * a2));
+}
+
+}
+
 Olsr::Olsr(ns3::Ptr<MeshNetDevice> net_device) :
     _net_device(net_device),
     _hello_interval(ns3::Minutes(10)),
-    _topology_control_interval(ns3::Minutes(10)),
+    _topology_control_interval(ns3::Minutes(30)),
+    _topology_control_min_interval(ns3::Minutes(1)),
+    _fisheye_scopes(),
+    _compact_hello(false),
+    _full_hello_interval(3),
     _cleanup_interval(ns3::Minutes(10)),
+    _route_update_delay(ns3::Seconds(1)),
     _default_ttl(8),
+    _link_range(0),
+    _gateway(false),
+    _gateway_routes_only(false),
     // Neighbor table TTL
     _neighbors(ns3::Minutes(21)),
+    _hello_sequence(0),
+    _hellos_since_full(0),
+    _hello_bytes_sent(0),
     _mpr_selector(ns3::Minutes(21)),
-    _topology(ns3::Minutes(21))
+    // Two refresh intervals, so that one missed refresh does not remove entries
+    _topology(ns3::Minutes(61)),
+    _cell_size(0),
+    _cluster_head(false),
+    _route_update_scheduled(false),
+    _route_update_time(),
+    _routes_calculated(false),
+    _route_updates(0),
+    _topology_control_sequence(_mpr_selector.Sequence()),
+    _last_topology_control(),
+    _link_expiry_time(),
+    _link_expiry_checked(),
+    _topology_control_sent(0),
+    _topology_control_triggered(0),
+    _topology_control_bytes_sent(0),
+    _topology_control_forwarded(0),
+    _topology_control_suppressed(0)
 {
     if (_net_device) {
         _net_device->SetReceiveCallback(std::bind(&Olsr::OnPacketReceived, this, std::placeholders::_1));
@@ -41,9 +107,30 @@ void Olsr::SetNetDevice(ns3::Ptr<MeshNetDevice> net_device) {
 }
 
 void Olsr::Start() {
-    ns3::Simulator::Schedule(_hello_interval, &Olsr::SendHello, this);
-    ns3::Simulator::Schedule(_topology_control_interval, &Olsr::SendTopologyControl, this);
-    ns3::Simulator::Schedule(_cleanup_interval, &Olsr::Cleanup, this);
+    RegisterTimer(_hello_interval, [this]() { SendHello(); });
+    RegisterTimer(_topology_control_interval, [this]() { RefreshTopologyControl(); });
+    RegisterTimer(_cleanup_interval, [this]() { Cleanup(); });
+}
+
+void Olsr::Stop() {
+    NetworkProtocol::Stop();
+    ns3::Simulator::Cancel(_topology_control_event);
+    ns3::Simulator::Cancel(_link_expiry_event);
+    // A registered batched route update finds no changes
+    _route_changes.clear();
+    _neighbors.clear();
+    _advertised.clear();
+    _mpr_selector.clear();
+    _topology.clear();
+    _routing.clear();
+    _gateways.clear();
+    _default_gateway = boost::none;
+    _gateway_path.clear();
+    _clusters.clear();
+    _cell = boost::none;
+    _cluster_head = false;
+    _adjacent_cells.clear();
+    _duplicates.clear();
 }
 
 void Olsr::Send(ns3::Packet packet, IcaoAddress destination) {
@@ -67,8 +154,23 @@ void Olsr::SendWithHeader(ns3::Packet packet, IcaoAddress destination) {
     if (destination == IcaoAddress::Broadcast()) {
         SendMultipointRelay(packet);
     } else {
+        // Apply any pending topology changes before looking up the route
+        UpdateRoutes();
         // Look up route
-        const auto route = _routing.Find(destination);
+        auto route = _routing.Find(destination);
+        if (route == _routing.end()) {
+            // Heads and gateways in other cells are reached through cells
+            const auto next_hop = ClusterNextHop(destination);
+            if (next_hop) {
+                ADDR_LOG_INFO("Found cluster route via next hop " << *next_hop << " to " << destination);
+                SendPacket(packet, *next_hop);
+                return;
+            }
+        }
+        if (route == _routing.end() && _default_gateway) {
+            ADDR_LOG_INFO("Using default route via gateway " << *_default_gateway << " to " << destination);
+            route = _routing.Find(*_default_gateway);
+        }
         if (route != _routing.end()) {
             ADDR_LOG_INFO("Found route via next hop " << route->NextHop() << " to " << destination);
             // Send over next hop
@@ -85,17 +187,21 @@ void Olsr::SetReceiveCallback(receive_callback callback) {
 
 void Olsr::OnPacketReceived(ns3::Packet packet) {
     NS_LOG_FUNCTION(this << packet);
-    RecordPacketReceived(packet.GetUid());
-
     MeshHeader mesh_header;
     packet.RemoveHeader(mesh_header);
+    if (ForwardData(packet)) {
+        return;
+    }
 
     Header header;
     packet.RemoveHeader(header);
     const auto message_type = header.GetMessage().Type();
+    // Data packets are recorded as received when they reach their destination
     if (message_type == MessageType::Hello) {
-        HandleHello(mesh_header.SourceAddress(), header.GetMessage().Neighbors());
+        RecordPacketReceived(packet.GetUid());
+        HandleHello(mesh_header.SourceAddress(), header.GetMessage());
     } else if (message_type == MessageType::TopologyControl) {
+        RecordPacketReceived(packet.GetUid());
         HandleTopologyControl(mesh_header.SourceAddress(), std::move(header.GetMessage()));
     } else if (message_type == MessageType::Data) {
         HandleData(packet, std::move(header.GetMessage()));
@@ -104,6 +210,25 @@ void Olsr::OnPacketReceived(ns3::Packet packet) {
     }
 }
 
+bool Olsr::ForwardData(ns3::Packet& packet) {
+    DataForwardHeader prefix;
+    if (packet.GetSize() < prefix.GetSerializedSize()) {
+        return false;
+    }
+    // The prefix is put back if the packet is not forwarded
+    packet.RemoveHeader(prefix);
+    if (!prefix.IsData() || prefix.Ttl() == 0 || prefix.Destination() == _net_device->GetAddress()) {
+        // Handled by HandleData()
+        packet.AddHeader(prefix);
+        return false;
+    }
+    ADDR_LOG_INFO("Forwarding data from " << prefix.Origin() << " to " << prefix.Destination());
+    prefix.DecrementTtl();
+    packet.AddHeader(prefix);
+    SendWithHeader(packet, prefix.Destination());
+    return true;
+}
+
 void Olsr::SendPacket(ns3::Packet packet, IcaoAddress destination) {
     ADDR_LOG_INFO("Olsr::SendPacket " << packet << " to " << destination);
     assert(_net_device);
@@ -115,6 +240,7 @@ void Olsr::HandleData(ns3::Packet packet, Message&& message) {
     const auto local_address = _net_device->GetAddress();
     if (message.Destination() == local_address) {
         ADDR_LOG_INFO("Data arrived at " << local_address << " from " << message.Origin());
+        RecordPacketReceived(packet.GetUid());
         if (_receive_callback) {
             _receive_callback(packet);
         } else {
@@ -133,40 +259,164 @@ void Olsr::HandleData(ns3::Packet packet, Message&& message) {
 void Olsr::SendHello() {
     // ADDR_LOG_INFO("Sending hello");
     auto packet = ns3::Packet();
-    auto message = Message(MessageType::Hello);
+    auto message = _compact_hello ? MakeCompactHello() : Message::Hello(_neighbors);
+    if (_link_range > 0 || _cell_size > 0) {
+        message.HelloFields().SetSenderMotion(LocalMotion());
+    }
+    // The message may refer to the neighbor table, which is serialized into the packet here
+    const auto header = Header(message);
+    _hello_bytes_sent += header.GetSerializedSize();
+    packet.AddHeader(header);
+    RecordPacketSent(packet.GetUid(), PacketRecorder::PacketType::Hello);
+    SendPacket(packet, IcaoAddress::Broadcast());
+}
 
-    // Add neighbors
-    message.Neighbors() = _neighbors;
+Message Olsr::MakeCompactHello() {
+    const auto full = _hellos_since_full == 0;
+    _hellos_since_full = (_hellos_since_full + 1) % _full_hello_interval;
+    auto message = full ? Message::Hello(_neighbors) : Message(MessageType::Hello);
+    auto& fields = message.HelloFields();
+    fields.SetCompact(true);
+    fields.SetFull(full);
+    fields.SetSequence(_hello_sequence);
+    _hello_sequence++;
 
-    packet.AddHeader(Header(message));
-    RecordPacketSent(packet.GetUid(), PacketRecorder::PacketType::Management);
-    SendPacket(packet, IcaoAddress::Broadcast());
+    if (!full) {
+        // Both tables are sorted, so walk through them together
+        auto& changed = message.Neighbors();
+        auto in_neighbors = _neighbors.begin();
+        auto in_advertised = _advertised.begin();
+        while (in_neighbors != _neighbors.end() || in_advertised != _advertised.end()) {
+            if (in_advertised == _advertised.end() || (in_neighbors != _neighbors.end() && in_neighbors->first < in_advertised->first)) {
+                // Added
+                changed.Insert(NeighborTableEntry(in_neighbors->first, in_neighbors->second.State()));
+                ++in_neighbors;
+            } else if (in_neighbors == _neighbors.end() || in_advertised->first < in_neighbors->first) {
+                // Removed
+                fields.Removed().push_back(in_advertised->first);
+                ++in_advertised;
+            } else {
+                if (in_neighbors->second.State() != in_advertised->second) {
+                    changed.Insert(NeighborTableEntry(in_neighbors->first, in_neighbors->second.State()));
+                }
+                ++in_neighbors;
+                ++in_advertised;
+            }
+        }
+    }
 
-    // Schedule next
-    ns3::Simulator::Schedule(_hello_interval, &Olsr::SendHello, this);
+    _advertised.clear();
+    _advertised.reserve(_neighbors.size());
+    for (const auto& entry : _neighbors) {
+        _advertised.insert(std::make_pair(entry.first, entry.second.State()));
+    }
+    return message;
 }
 
-void Olsr::SendTopologyControl() {
+void Olsr::RefreshTopologyControl() {
+    if (_topology_control_event.IsRunning()) {
+        // A message with changes is about to be sent
+        return;
+    }
+    if (_topology_control_sent != 0 && ns3::Simulator::Now() - _last_topology_control < _topology_control_min_interval) {
+        return;
+    }
+    SendTopologyControl();
+}
+
+void Olsr::OnMprSelectorChanged() {
+    if (_mpr_selector.Sequence() == _topology_control_sequence || _topology_control_event.IsRunning()) {
+        return;
+    }
+    const auto since_last = ns3::Simulator::Now() - _last_topology_control;
+    if (_topology_control_sent == 0 || since_last >= _topology_control_min_interval) {
+        SendTriggeredTopologyControl();
+    } else {
+        ADDR_LOG_INFO("Delaying topology control for changed MPR selectors");
+        _topology_control_event = ns3::Simulator::Schedule(_topology_control_min_interval - since_last,
+            &Olsr::SendTriggeredTopologyControl, this);
+    }
+}
+
+void Olsr::SendTriggeredTopologyControl() {
     if (!_mpr_selector.empty()) {
+        _topology_control_triggered++;
+    }
+    SendTopologyControl();
+}
+
+void Olsr::SendTopologyControl() {
+    ns3::Simulator::Cancel(_topology_control_event);
+    if (_cell_size > 0 && UpdateClusterState()) {
+        // The message advertises a changed cluster state
+        _mpr_selector.IncrementSequence();
+    }
+    if (!_mpr_selector.empty() || _gateway || _cell_size > 0) {
         ADDR_LOG_INFO("Sending topology control");
+        // Non-zero TTL for flooding. Gateway and cluster head
+        // advertisements reach every node.
+        const auto ttl = (_gateway || _cluster_head) ? flood_ttl : NextTopologyControlTtl();
+        auto message = Message(MessageType::TopologyControl, ttl);
+        message.SetGateway(_gateway);
+        if (_cell) {
+            message.Cluster() = ClusterInfo { *_cell, _cluster_head,
+                std::vector<std::uint16_t>(_adjacent_cells.begin(), _adjacent_cells.end()) };
+        }
+        _topology_control_sequence = _mpr_selector.Sequence();
+        _last_topology_control = ns3::Simulator::Now();
+        _topology_control_sent++;
 
         auto packet = ns3::Packet();
-        // Non-zero TTL for flooding
-        auto message = Message(MessageType::TopologyControl, _default_ttl);
         message.MprSelector() = _mpr_selector;
+        if (_link_range > 0) {
+            auto& lifetimes = message.LinkLifetimes();
+            lifetimes.reserve(_mpr_selector.size());
+            for (const auto& entry : _mpr_selector) {
+                lifetimes.push_back(AdvertisedLinkLifetime(entry.first));
+            }
+        }
         message.SetOriginator(_net_device->GetAddress());
-        packet.AddHeader(Header(message));
-        RecordPacketSent(packet.GetUid(), PacketRecorder::PacketType::Management);
+        // Ignore this message when neighbors forward it back
+        _duplicates.Insert(message.Originator(), _mpr_selector.Sequence());
+        const auto header = Header(message);
+        _topology_control_bytes_sent += header.GetSerializedSize();
+        packet.AddHeader(header);
+        RecordPacketSent(packet.GetUid(), PacketRecorder::PacketType::TopologyControl);
         SendPacket(packet, IcaoAddress::Broadcast());
+    }
+}
 
+std::uint8_t Olsr::NextTopologyControlTtl() const {
+    if (_fisheye_scopes.empty()) {
+        return _default_ttl;
+    }
+    // Scope i is used by every 2^i-th message
+    std::size_t scope = 0;
+    auto count = _topology_control_sent;
+    while (scope + 1 < _fisheye_scopes.size() && count % 2 == 0) {
+        scope++;
+        count /= 2;
     }
-    ns3::Simulator::Schedule(_topology_control_interval, &Olsr::SendTopologyControl, this);
+    return _fisheye_scopes[scope];
 }
 
 void Olsr::HandleTopologyControl(IcaoAddress sender, Message&& message) {
     ADDR_LOG_INFO("HandleTopologyControl originating from " << message.Originator());
 
     const auto& message_table = message.MprSelector();
+    if (!_duplicates.Insert(message.Originator(), message_table.Sequence())) {
+        ADDR_LOG_INFO("Ignoring duplicate topology control message");
+        _topology_control_suppressed++;
+        return;
+    }
+    UpdateGateway(message.Originator(), message.IsGateway());
+    if (_cell_size > 0 && message.Cluster() && !HandleClusterInfo(message)) {
+        // From another cell. Only heads and gateways advertise beyond their cells.
+        if (message.Cluster()->head || message.IsGateway()) {
+            ForwardTopologyControl(std::move(message));
+        }
+        return;
+    }
     auto in_table = _topology.Find(message.Originator());
     if (in_table != _topology.end()) {
         ADDR_LOG_INFO("Originator is in topology table");
@@ -179,37 +429,74 @@ void Olsr::HandleTopologyControl(IcaoAddress sender, Message&& message) {
             // This message replaces the old entry
             ADDR_LOG_INFO("Removing old topology entry");
             _topology.Remove(in_table);
+            MarkRouteChanged(message.Originator());
         }
     }
 
+    // A message that has not been forwarded comes from a neighbor
+    const auto distance = static_cast<std::uint8_t>(std::min(message.HopCount() + 1, 255));
+    const auto now = ns3::Simulator::Now();
+    const auto& lifetimes = message.LinkLifetimes();
+    std::size_t index = 0;
     for (auto& entry : message_table) {
         auto& mpr_entry = entry.second;
+        // When the link from the originator to this destination is predicted to break
+        auto link_expires = ns3::Time::Max();
+        if (!lifetimes.empty() && lifetimes[index] != std::numeric_limits<std::uint8_t>::max()) {
+            link_expires = now + ns3::Minutes(lifetimes[index]);
+        }
+        index++;
         auto in_table = _topology.Find(mpr_entry.Address());
         if (in_table != _topology.end()) {
             if (in_table->LastHop() == message.Originator()) {
                 ADDR_LOG_INFO("Marking entry seen");
+                if (in_table->Distance() != distance) {
+                    _topology.SetDistance(in_table, distance);
+                }
                 in_table->MarkSeen();
+                in_table->SetLinkExpires(link_expires);
+            } else if (!lifetimes.empty() && in_table->LinkExpires() > link_expires
+                && now - in_table->Updated() < _topology_control_interval) {
+                // The current last hop has a recently advertised link that lasts longer
+                ADDR_LOG_INFO("Keeping longer-lived last hop " << in_table->LastHop() << " to " << in_table->Destination());
             } else {
                 // Update last hop
                 ADDR_LOG_INFO("Updating last hop to " << in_table->Destination() << ": old " << in_table->LastHop() << ", new " << message.Originator());
-                in_table->SetLastHop(message.Originator());
+                _topology.SetLastHop(in_table, message.Originator());
+                if (in_table->Distance() != distance) {
+                    _topology.SetDistance(in_table, distance);
+                }
                 in_table->MarkSeen();
+                in_table->SetLinkExpires(link_expires);
+                MarkRouteChanged(in_table->Destination());
             }
         } else {
             // Not in table, insert
             ADDR_LOG_INFO("Inserting into topology table: destination " << mpr_entry.Address() << ", next hop " << message.Originator() << ", sequence " << message_table.Sequence());
-            _topology.Insert(TopologyTable::Entry(mpr_entry.Address(), message.Originator(), message_table.Sequence()));
+            auto topology_entry = TopologyTable::Entry(mpr_entry.Address(), message.Originator(), message_table.Sequence(), distance);
+            topology_entry.SetLinkExpires(link_expires);
+            _topology.Insert(topology_entry);
+            MarkRouteChanged(mpr_entry.Address());
         }
     }
 
     ADDR_LOG_INFO("Updated topology table:\n" << TopologyTable::PrintTable(_topology));
 
-    // Forward message
+    ForwardTopologyControl(std::move(message));
+}
+
+void Olsr::ForwardTopologyControl(Message&& message) {
     if (message.Ttl() > 0) {
         message.DecrementTtl();
+        if (message.HopCount() != std::numeric_limits<std::uint8_t>::max()) {
+            message.SetHopCount(message.HopCount() + 1);
+        }
+        _topology_control_forwarded++;
         // Resend to each of the multipoint relay neighbors
         ns3::Packet packet;
-        packet.AddHeader(Header(message));
+        const auto header = Header(message);
+        _topology_control_bytes_sent += header.GetSerializedSize();
+        packet.AddHeader(header);
         SendMultipointRelay(packet);
     }
 }
@@ -228,19 +515,92 @@ void Olsr::SendMultipointRelay(ns3::Packet packet) {
     }
 }
 
-void Olsr::HandleHello(IcaoAddress sender, const NeighborTable& sender_neighbors) {
-    UpdateNeighbors(sender, sender_neighbors);
-    UpdateMprSelector(sender, sender_neighbors);
+void Olsr::HandleHello(IcaoAddress sender, const Message& message) {
+    const auto local_address = _net_device->GetAddress();
+    const auto& fields = message.HelloFields();
+    const auto& sender_neighbors = message.Neighbors();
+    ADDR_LOG_INFO(local_address << " handling hello from " << sender
+        << " with neighbors " << print_container::print(sender_neighbors)
+        << (fields.Full() ? "" : " (changes only)"));
+
+    // 2-hop neighbors reported by the sender, and the state it reported for this node
+    NeighborTableEntry::two_hop_set two_hop_neighbors;
+    boost::optional<LinkState> advertised_state;
+    // False if the 2-hop neighbors are not all known, so later changes can't be applied
+    auto sequence_known = true;
+    if (fields.Full()) {
+        two_hop_neighbors.reserve(sender_neighbors.size());
+        for (const auto& neighbor_entry : sender_neighbors) {
+            const auto address = neighbor_entry.first;
+            if (address != local_address) {
+                two_hop_neighbors.insert(address);
+            } else {
+                advertised_state = neighbor_entry.second.State();
+            }
+        }
+    } else {
+        const auto sender_entry = _neighbors.Find(sender);
+        if (sender_entry == _neighbors.end()) {
+            // Add the neighbor now instead of up to a full Hello cycle later.
+            // Its 2-hop neighbors are unknown until its next full Hello.
+            ADDR_LOG_INFO("Adding neighbor " << sender << " from changes only, without 2-hop neighbors");
+            sequence_known = false;
+        } else {
+            const auto& table_entry = sender_entry->second;
+            two_hop_neighbors = table_entry.TwoHopNeighbors();
+            advertised_state = table_entry.AdvertisedState();
+            const auto& previous_sequence = table_entry.HelloSequence();
+            if (!previous_sequence || *previous_sequence != static_cast<std::uint8_t>(fields.Sequence() - 1)) {
+                ADDR_LOG_INFO("Missed a Hello from " << sender << ", ignoring 2-hop changes until its next full Hello");
+                sequence_known = false;
+            }
+        }
+        // Apply the changes to the neighbors from the previous Hello. If a
+        // Hello was missed, only the changes to this node are used.
+        for (const auto& neighbor_entry : sender_neighbors) {
+            const auto address = neighbor_entry.first;
+            if (address == local_address) {
+                advertised_state = neighbor_entry.second.State();
+            } else if (sequence_known) {
+                two_hop_neighbors.insert(address);
+            }
+        }
+        for (const auto& address : fields.Removed()) {
+            if (address == local_address) {
+                advertised_state = boost::none;
+            } else if (sequence_known) {
+                two_hop_neighbors.erase(address);
+            }
+        }
+    }
+
+    boost::optional<std::uint8_t> sequence;
+    if (fields.Compact() && sequence_known) {
+        sequence = fields.Sequence();
+    }
+    UpdateNeighbors(sender, std::move(two_hop_neighbors), advertised_state, sequence);
+    if (_link_range > 0 && fields.SenderMotion()) {
+        UpdateLinkExpiry(sender, *fields.SenderMotion());
+    }
+    if (_cell_size > 0 && fields.SenderMotion()) {
+        auto sender_entry = _neighbors.Find(sender);
+        if (sender_entry != _neighbors.end()) {
+            sender_entry->second.SetCell(_clusters.CellOf(fields.SenderMotion()->position));
+        }
+    }
+    UpdateMprSelector(sender, advertised_state);
     ADDR_LOG_INFO(DumpState(*this));
 }
 
-void Olsr::UpdateNeighbors(IcaoAddress sender, const NeighborTable& sender_neighbors) {
+void Olsr::UpdateNeighbors(IcaoAddress sender, NeighborTableEntry::two_hop_set&& two_hop_neighbors,
+    const boost::optional<LinkState>& advertised_state, const boost::optional<std::uint8_t>& sequence) {
     const auto local_address = _net_device->GetAddress();
-    ADDR_LOG_INFO(local_address << " handling hello from " << sender
-        << " with neighbors " << print_container::print(sender_neighbors));
 
     // Update neighbors of this
-    const auto sender_entry = _neighbors.Find(sender);
+    // The multipoint relay set only needs to be selected again if some
+    // 2-hop neighbor is no longer reached through a multipoint relay
+    auto relays_uncovered = false;
+    auto sender_entry = _neighbors.Find(sender);
     if (sender_entry != _neighbors.end()) {
         // Have an entry
         auto& table_entry = sender_entry->second;
@@ -249,22 +609,34 @@ void Olsr::UpdateNeighbors(IcaoAddress sender, const NeighborTable& sender_neigh
             ADDR_LOG_INFO(local_address << ": upgrading neighbor "
                 << sender << " to bidirectional");
             table_entry.SetState(LinkState::Bidirectional);
-        }
-
-        // Update 2-hop neighbors
-        table_entry.TwoHopNeighbors().clear();
-        for (const auto& neighbor_entry : sender_neighbors) {
-            const auto address = neighbor_entry.first;
-            if (address != local_address) {
-                table_entry.TwoHopNeighbors().insert(address);
+            _neighbors.SetTwoHopNeighbors(sender_entry, two_hop_neighbors);
+            // Routes to the 2-hop neighbors are updated with the route to the sender
+            MarkRouteChanged(sender);
+            relays_uncovered = olsr::relays_uncovered(_neighbors, table_entry.TwoHopNeighbors());
+        } else if (two_hop_neighbors != table_entry.TwoHopNeighbors()) {
+            // Update 2-hop neighbors
+            _neighbors.SetTwoHopNeighbors(sender_entry, two_hop_neighbors);
+            relays_uncovered = olsr::relays_uncovered(_neighbors, two_hop_neighbors)
+                || olsr::relays_uncovered(_neighbors, table_entry.TwoHopNeighbors());
+            if (table_entry.State() != LinkState::Unidirectional) {
+                // Routes to added and removed 2-hop neighbors may change
+                std::vector<IcaoAddress> changed;
+                std::set_symmetric_difference(two_hop_neighbors.begin(), two_hop_neighbors.end(),
+                    table_entry.TwoHopNeighbors().begin(), table_entry.TwoHopNeighbors().end(),
+                    std::back_inserter(changed));
+                for (const auto& address : changed) {
+                    MarkRouteChanged(address);
+                }
             }
         }
 
+        table_entry.SetHelloSequence(sequence);
+        table_entry.SetAdvertisedState(advertised_state);
         table_entry.MarkSeen();
     } else {
         // Nothing here, add an entry
         LinkState new_link_state;
-        if (sender_neighbors.Find(local_address) != sender_neighbors.end()) {
+        if (advertised_state) {
             // Other is aware of this, so the link is bidirectional
             new_link_state = LinkState::Bidirectional;
             ADDR_LOG_INFO(local_address << ": adding bidirectional neighbor "
@@ -277,46 +649,403 @@ void Olsr::UpdateNeighbors(IcaoAddress sender, const NeighborTable& sender_neigh
         }
         // Build an entry containing the 2-hop neighbors
         auto entry = NeighborTableEntry(sender, new_link_state);
+        entry.TwoHopNeighbors() = std::move(two_hop_neighbors);
+        entry.SetHelloSequence(sequence);
+        entry.SetAdvertisedState(advertised_state);
+        _neighbors.Insert(entry);
+        if (new_link_state == LinkState::Bidirectional) {
+            MarkRouteChanged(sender);
+            relays_uncovered = olsr::relays_uncovered(_neighbors, entry.TwoHopNeighbors());
+        }
+    }
 
-        for (const auto& neighbor_entry : sender_neighbors) {
-            const auto address = neighbor_entry.first;
-            if (address != local_address) {
-                entry.TwoHopNeighbors().insert(address);
+    if (relays_uncovered) {
+        UpdateMultipointRelays();
+    }
+}
+
+void Olsr::UpdateMultipointRelays() {
+    // Without the metric, all links are predicted to last forever
+    const auto preferred_until = _link_range > 0 ? ns3::Simulator::Now() + _hello_interval + _hello_interval : ns3::Time();
+    update_multipoint_relay(&_neighbors, preferred_until);
+}
+
+boost::optional<NodeMotion> Olsr::LocalMotion() const {
+    const auto mobility = _net_device->GetMobilityModel();
+    if (!mobility) {
+        return boost::none;
+    }
+    return NodeMotion { mobility->GetPosition(), mobility->GetVelocity() };
+}
+
+void Olsr::UpdateLinkExpiry(IcaoAddress sender, const NodeMotion& sender_motion) {
+    const auto local_motion = LocalMotion();
+    auto sender_entry = _neighbors.Find(sender);
+    if (!local_motion || sender_entry == _neighbors.end()) {
+        return;
+    }
+    auto& table_entry = sender_entry->second;
+    const auto now = ns3::Simulator::Now();
+    const auto lifetime = predict_link_lifetime(*local_motion, sender_motion, _link_range);
+    const auto expires = lifetime == ns3::Time::Max() ? lifetime : now + lifetime;
+    const auto old_expires = table_entry.LinkExpires();
+    table_entry.SetLinkExpires(expires);
+    ADDR_LOG_INFO("Link to " << sender << " predicted to last " << lifetime.GetSeconds() << " s");
+    if ((old_expires > now) != (expires > now)) {
+        MarkRouteChanged(sender);
+    }
+    if (expires > now && expires != ns3::Time::Max()) {
+        ScheduleLinkExpiry(expires);
+    }
+    const auto preferred_until = now + _hello_interval + _hello_interval;
+    if (table_entry.State() == LinkState::MultiPointRelay && old_expires >= preferred_until && expires < preferred_until) {
+        // A relay is no longer preferred
+        UpdateMultipointRelays();
+    }
+}
+
+void Olsr::ScheduleLinkExpiry(ns3::Time expires) {
+    if (_link_expiry_event.IsRunning() && _link_expiry_time <= expires) {
+        return;
+    }
+    ns3::Simulator::Cancel(_link_expiry_event);
+    _link_expiry_time = expires;
+    _link_expiry_event = ns3::Simulator::Schedule(expires - ns3::Simulator::Now(), &Olsr::HandleExpiredLinks, this);
+}
+
+void Olsr::HandleExpiredLinks() {
+    // Stop routing through neighbors whose links are predicted to have
+    // broken since the last call
+    const auto now = ns3::Simulator::Now();
+    auto relay_broken = false;
+    auto next_expires = ns3::Time::Max();
+    for (const auto& entry : _neighbors) {
+        const auto& neighbor_entry = entry.second;
+        const auto expires = neighbor_entry.LinkExpires();
+        if (expires > _link_expiry_checked && expires <= now) {
+            ADDR_LOG_INFO("Link to " << entry.first << " predicted to have broken");
+            const auto route = _routing.Find(entry.first);
+            if (route != _routing.end() && route->NextHop() == entry.first) {
+                MarkRouteChanged(entry.first);
             }
+            relay_broken = relay_broken || neighbor_entry.State() == LinkState::MultiPointRelay;
+        } else if (expires > now) {
+            next_expires = std::min(next_expires, expires);
         }
-        _neighbors.Insert(entry);
     }
+    _link_expiry_checked = now;
+    if (relay_broken) {
+        UpdateMultipointRelays();
+    }
+    if (next_expires != ns3::Time::Max()) {
+        ScheduleLinkExpiry(next_expires);
+    }
+}
 
-    // Update this node's multipoint relay set
-    update_multipoint_relay(&_neighbors);
+std::uint8_t Olsr::AdvertisedLinkLifetime(IcaoAddress selector) const {
+    const auto max = std::numeric_limits<std::uint8_t>::max();
+    const auto in_neighbors = _neighbors.Find(selector);
+    if (in_neighbors == _neighbors.end()) {
+        return 0;
+    }
+    const auto expires = in_neighbors->second.LinkExpires();
+    if (expires == ns3::Time::Max()) {
+        return max;
+    }
+    const auto minutes = (expires - ns3::Simulator::Now()).GetMinutes();
+    // 255 means no prediction, so longer lifetimes are sent as 254
+    return static_cast<std::uint8_t>(std::max(0.0, std::min(minutes, max - 1.0)));
 }
 
-void Olsr::UpdateMprSelector(IcaoAddress sender, const NeighborTable& sender_neighbors) {
-    const auto local_address = _net_device->GetAddress();
-    const auto self_in_sender_neighbors = sender_neighbors.Find(local_address);
-    if (self_in_sender_neighbors != sender_neighbors.end()) {
-        if (self_in_sender_neighbors->second.State() == LinkState::MultiPointRelay) {
-            // This is a multpoint relay of the sender
-            const auto in_mpr_selector = _mpr_selector.Find(sender);
-            if (in_mpr_selector != _mpr_selector.end()) {
-                in_mpr_selector->second.MarkSeen();
-            } else {
-                _mpr_selector.Insert(sender);
-                _mpr_selector.IncrementSequence();
-            }
+void Olsr::UpdateMprSelector(IcaoAddress sender, const boost::optional<LinkState>& advertised_state) {
+    if (advertised_state && *advertised_state == LinkState::MultiPointRelay) {
+        // This is a multpoint relay of the sender
+        const auto in_mpr_selector = _mpr_selector.Find(sender);
+        if (in_mpr_selector != _mpr_selector.end()) {
+            in_mpr_selector->second.MarkSeen();
+        } else {
+            _mpr_selector.Insert(sender);
+            _mpr_selector.IncrementSequence();
+            OnMprSelectorChanged();
         }
     }
 }
 
 void Olsr::Cleanup() {
     NS_LOG_FUNCTION(this);
-    _neighbors.RemoveExpired();
+    std::vector<IcaoAddress> removed;
+    std::vector<IcaoAddress> two_hop_removed;
+    _neighbors.RemoveExpired(&removed, &two_hop_removed);
+    if (!removed.empty()) {
+        // Removed neighbors may have been multipoint relays
+        UpdateMultipointRelays();
+    }
+    for (const auto& address : two_hop_removed) {
+        MarkRouteChanged(address);
+    }
     _mpr_selector.RemoveExpired();
-    _topology.RemoveExpired();
-    // Update all the routing
-    calculate_routes(&_routing, _neighbors, _topology);
+    OnMprSelectorChanged();
+    _topology.RemoveExpired(&removed);
+    for (const auto& address : removed) {
+        MarkRouteChanged(address);
+    }
+    const auto now = ns3::Simulator::Now();
+    for (const auto& entry : _gateways) {
+        if (entry.second <= now) {
+            ADDR_LOG_INFO("Gateway " << entry.first << " expired");
+            MarkRouteChanged(entry.first);
+        }
+    }
+    _gateways.erase_if([now](const std::pair<IcaoAddress, ns3::Time>& entry) {
+        return entry.second <= now;
+    });
+    if (_cell_size > 0) {
+        _clusters.RemoveExpired();
+        UpdateCluster();
+    }
+}
+
+bool Olsr::UpdateClusterState() {
+    const auto motion = LocalMotion();
+    if (!motion) {
+        return false;
+    }
+    auto changed = false;
+    const auto cell = _clusters.CellOf(motion->position);
+    if (!_cell || *_cell != cell) {
+        ADDR_LOG_INFO("Moved to cell " << cell);
+        _cell = cell;
+        // The members and topology of the previous cell are no longer used
+        _clusters.ClearMembers();
+        for (const auto& entry : _topology) {
+            MarkRouteChanged(entry.Destination());
+        }
+        _topology.clear();
+        changed = true;
+    }
+    const auto local_address = _net_device->GetAddress();
+    const auto head = _clusters.ElectHead(local_address) == local_address;
+    if (head != _cluster_head) {
+        ADDR_LOG_INFO((head ? "Became" : "No longer") << " the head of cell " << cell);
+        _cluster_head = head;
+        changed = true;
+    }
+    auto adjacent_cells = AdjacentCells();
+    if (adjacent_cells != _adjacent_cells) {
+        _adjacent_cells = std::move(adjacent_cells);
+        changed = true;
+    }
+    if (_cluster_head) {
+        // Other nodes learn about this cell from the messages of this node
+        _clusters.UpdateCell(cell, local_address, _adjacent_cells,
+            ns3::Simulator::Now() + _topology_control_interval + _topology_control_interval + ns3::Minutes(1));
+    }
+    return changed;
+}
+
+void Olsr::UpdateCluster() {
+    if (UpdateClusterState()) {
+        // The cluster information is part of the advertised state
+        _mpr_selector.IncrementSequence();
+        OnMprSelectorChanged();
+    }
+}
+
+ClusterTable::cell_set Olsr::AdjacentCells() const {
+    ClusterTable::cell_set cells;
+    for (const auto& entry : _neighbors) {
+        const auto& neighbor_entry = entry.second;
+        if (neighbor_entry.State() != LinkState::Unidirectional && neighbor_entry.Cell() && neighbor_entry.Cell() != _cell) {
+            cells.insert(*neighbor_entry.Cell());
+        }
+    }
+    if (_cluster_head) {
+        for (const auto& entry : _clusters.Members()) {
+            for (const auto cell : entry.second.adjacent_cells) {
+                if (cell != _cell) {
+                    cells.insert(cell);
+                }
+            }
+        }
+    }
+    // The message format has room for 255 cells
+    while (cells.size() > std::numeric_limits<std::uint8_t>::max()) {
+        cells.erase(*(cells.end() - 1));
+    }
+    return cells;
+}
+
+bool Olsr::HandleClusterInfo(const Message& message) {
+    const auto& cluster = *message.Cluster();
+    const auto expires = ns3::Simulator::Now() + _topology_control_interval + _topology_control_interval + ns3::Minutes(1);
+    ClusterTable::cell_set adjacent_cells;
+    for (const auto cell : cluster.adjacent_cells) {
+        adjacent_cells.insert(cell);
+    }
+    if (cluster.head) {
+        _clusters.UpdateCell(cluster.cell, message.Originator(), adjacent_cells, expires);
+    }
+    if (cluster.head || message.IsGateway()) {
+        _clusters.UpdateLocation(message.Originator(), cluster.cell, expires);
+    }
+    if (!_cell || cluster.cell != *_cell) {
+        return false;
+    }
+    const auto new_member = _clusters.Members().find(message.Originator()) == _clusters.Members().end();
+    _clusters.UpdateMember(message.Originator(), std::move(adjacent_cells), expires);
+    if (new_member) {
+        // The new member may be the head
+        UpdateCluster();
+    }
+    return true;
+}
+
+boost::optional<IcaoAddress> Olsr::ClusterNextHop(IcaoAddress destination) {
+    if (_cell_size == 0 || !_cell) {
+        return boost::none;
+    }
+    const auto location = _clusters.FindLocation(destination);
+    if (!location || *location == *_cell) {
+        return boost::none;
+    }
+    const auto next_cell = _clusters.NextCell(*_cell, *location);
+    if (!next_cell) {
+        ADDR_LOG_INFO("No path of cells from " << *_cell << " to " << *location);
+        return boost::none;
+    }
+    // A neighbor in the next cell, preferring the destination
+    boost::optional<IcaoAddress> next_hop;
+    for (const auto& entry : _neighbors) {
+        const auto& neighbor_entry = entry.second;
+        if (neighbor_entry.State() != LinkState::Unidirectional && neighbor_entry.Cell() == next_cell) {
+            if (entry.first == destination) {
+                return destination;
+            }
+            if (!next_hop) {
+                next_hop = entry.first;
+            }
+        }
+    }
+    if (next_hop) {
+        return next_hop;
+    }
+    // Otherwise, the nearest member next to the next cell
+    auto nearest_distance = std::numeric_limits<std::uint16_t>::max();
+    for (const auto& entry : _clusters.Members()) {
+        if (entry.second.adjacent_cells.count(*next_cell) == 0) {
+            continue;
+        }
+        const auto route = _routing.Find(entry.first);
+        if (route != _routing.end() && route->Distance() < nearest_distance) {
+            next_hop = route->NextHop();
+            nearest_distance = route->Distance();
+        }
+    }
+    return next_hop;
+}
+
+void Olsr::UpdateGateway(IcaoAddress originator, bool gateway) {
+    if (gateway) {
+        // Gateways refresh their advertisements every interval
+        const auto expires = ns3::Simulator::Now() + _topology_control_interval + _topology_control_interval + ns3::Minutes(1);
+        const auto inserted = _gateways.insert(std::make_pair(originator, expires));
+        if (inserted.second) {
+            ADDR_LOG_INFO("New gateway " << originator);
+            MarkRouteChanged(originator);
+        } else {
+            inserted.first->second = expires;
+        }
+    } else if (_gateways.erase(originator) != 0) {
+        ADDR_LOG_INFO(originator << " is no longer a gateway");
+        MarkRouteChanged(originator);
+    }
+}
+
+void Olsr::UpdateDefaultGateway() {
+    boost::optional<IcaoAddress> nearest;
+    std::uint16_t nearest_distance = std::numeric_limits<std::uint16_t>::max();
+    if (!_gateway) {
+        for (const auto& entry : _gateways) {
+            const auto route = _routing.Find(entry.first);
+            if (route != _routing.end() && route->Distance() < nearest_distance) {
+                nearest = entry.first;
+                nearest_distance = route->Distance();
+            }
+        }
+    }
+    if (nearest != _default_gateway) {
+        ADDR_LOG_INFO("Default gateway changed to " << (nearest ? *nearest : IcaoAddress()));
+        _default_gateway = nearest;
+    }
+}
+
+void Olsr::MarkRouteChanged(IcaoAddress address) {
+    if (_gateway_routes_only && !AffectsRoutes(address)) {
+        return;
+    }
+    _route_changes.insert(address);
+    if (!_route_update_scheduled) {
+        _route_update_scheduled = true;
+        _route_update_time = BatchRunner::Default().Schedule(_route_update_delay,
+            [this]() { CalculateRoutes(_route_update_time); },
+            [this]() {
+                _route_update_scheduled = false;
+                FinishRouteUpdate();
+            });
+    }
+}
+
+bool Olsr::AffectsRoutes(IcaoAddress address) const {
+    return _gateway_path.count(address) != 0
+        || _gateways.find(address) != _gateways.end()
+        || _neighbors.Find(address) != _neighbors.end()
+        || _routing.Find(address) != _routing.end();
+}
+
+void Olsr::UpdateRoutes() {
+    if (_route_changes.empty()) {
+        return;
+    }
+    // The registered batched update still runs, and finds no changes unless
+    // more happen before it
+    CalculateRoutes(ns3::Simulator::Now());
+    FinishRouteUpdate();
+}
+
+void Olsr::CalculateRoutes(ns3::Time now) {
+    if (_route_changes.empty()) {
+        return;
+    }
+    _route_updates++;
+    // Without the metric, link lifetime predictions are ignored
+    if (_link_range <= 0) {
+        now = ns3::Time();
+    }
+    if (_gateway_routes_only) {
+        // Following last hops from the gateways is faster than updating
+        std::vector<IcaoAddress> gateways;
+        gateways.reserve(_gateways.size());
+        for (const auto& entry : _gateways) {
+            gateways.push_back(entry.first);
+        }
+        calculate_gateway_routes(&_routing, _neighbors, _topology, gateways, &_gateway_path, now);
+    } else if (_route_changes.size() > (_topology.size() + _neighbors.size()) / 2) {
+        // Most routes may have changed, so recalculating everything is faster
+        calculate_routes(&_routing, _neighbors, _topology, now);
+    } else {
+        update_routes(&_routing, _neighbors, _topology, _route_changes, now);
+    }
+    _route_changes.clear();
+    _routes_calculated = true;
+}
+
+void Olsr::FinishRouteUpdate() {
+    if (!_routes_calculated) {
+        return;
+    }
+    _routes_calculated = false;
+    UpdateDefaultGateway();
     ADDR_LOG_INFO("Routing table:\n" << RoutingTable::PrintTable(_routing));
-    ns3::Simulator::Schedule(_cleanup_interval, &Olsr::Cleanup, this);
 }
 
 Olsr::DumpState::DumpState(const Olsr& olsr) :
@@ -337,10 +1066,87 @@ std::ostream& operator << (std::ostream& stream, const Olsr::DumpState& state) {
     }
     stream << "}\n";
     stream << "Topology table:\n" << TopologyTable::PrintTable(olsr.Topology()) << '\n';
-    stream << "Routing table:\n" << RoutingTable::PrintTable(olsr.Routing()) << "\n}";
+    stream << "Routing table:\n" << RoutingTable::PrintTable(olsr.Routing()) << '\n';
+    stream << "Topology control sent " << std::dec << olsr.TopologyControlSent()
+        << " (" << olsr.TopologyControlTriggered() << " for changes), forwarded " << olsr.TopologyControlForwarded()
+        << ", " << olsr.TopologyControlBytesSent() << " bytes"
+        << ", duplicates suppressed " << olsr.TopologyControlSuppressed()
+        << ", duplicate entries evicted " << olsr.DuplicateEvictions() << '\n';
+    stream << "Gateways " << olsr.Gateways().size();
+    if (olsr.DefaultGateway()) {
+        stream << ", default " << *olsr.DefaultGateway();
+    }
+    stream << '\n';
+    if (olsr.Cell()) {
+        stream << "Cell " << *olsr.Cell() << (olsr.IsClusterHead() ? ", cluster head" : "")
+            << ", " << olsr.Clusters().Members().size() << " members\n";
+        stream << "Cells:\n" << ClusterTable::PrintTable(olsr.Clusters()) << '\n';
+    }
+    stream << "Route updates " << olsr.RouteUpdates() << '\n';
+    stream << "Hello bytes sent " << olsr.HelloBytesSent() << "\n}";
     return stream;
 }
 
+void Olsr::SetCompactHello(bool compact) {
+    _compact_hello = compact;
+}
+
+void Olsr::SetFullHelloInterval(unsigned int interval) {
+    assert(interval != 0);
+    _full_hello_interval = interval;
+    _hellos_since_full = 0;
+}
+
+void Olsr::SetTopologyControlIntervals(ns3::Time min_interval, ns3::Time refresh_interval) {
+    _topology_control_min_interval = min_interval;
+    _topology_control_interval = refresh_interval;
+    UpdateTopologyTtls();
+}
+
+void Olsr::SetLinkLifetimeMetric(double range) {
+    assert(range >= 0);
+    _link_range = range;
+}
+
+void Olsr::SetGateway(bool gateway) {
+    _gateway = gateway;
+}
+
+void Olsr::SetGatewayRoutesOnly(bool gateway_routes_only) {
+    _gateway_routes_only = gateway_routes_only;
+}
+
+void Olsr::SetClusterCellSize(double cell_size) {
+    assert(cell_size >= 0);
+    _cell_size = cell_size;
+    if (cell_size > 0) {
+        _clusters = ClusterTable(cell_size);
+    }
+}
+
+void Olsr::SetFisheyeScopes(std::vector<std::uint8_t> scopes) {
+    assert(std::is_sorted(scopes.begin(), scopes.end()));
+    _fisheye_scopes = std::move(scopes);
+    UpdateTopologyTtls();
+}
+
+void Olsr::UpdateTopologyTtls() {
+    // Entries are kept for two refresh intervals of the smallest scope that
+    // reaches them, so that one missed refresh does not remove them. A
+    // message with TTL t reaches nodes t + 1 hops away, and scope i is
+    // refreshed every 2^i intervals.
+    auto interval = _topology_control_interval;
+    std::vector<ns3::Time> ttls;
+    for (const auto scope : _fisheye_scopes) {
+        while (ttls.size() < static_cast<std::size_t>(scope) + 1) {
+            ttls.push_back(interval + interval + ns3::Minutes(1));
+        }
+        interval = interval + interval;
+    }
+    _topology.SetTtl(ttls.empty() ? interval + interval + ns3::Minutes(1) : ttls.back());
+    _topology.SetDistanceTtls(std::move(ttls));
+}
+
 IcaoAddress Olsr::Address() const {
     assert(_net_device);
     return _net_device->GetAddress();
@@ -6,18 +6,24 @@
 #include "neighbor_table.h"
 #include "mpr_table.h"
 #include "topology_table.h"
+#include "cluster_table.h"
 #include "routing_table.h"
+#include "duplicate_set.h"
 #include "packet_recorder/packet_recorder.h"
 #include "network/network_protocol.h"
 #include <ns3/packet.h>
 #include <ns3/nstime.h>
+#include <ns3/event-id.h>
 #include <functional>
 #include <ostream>
 #include <memory>
+#include <set>
+#include <vector>
 
 namespace olsr {
 
 class Message;
+struct NodeMotion;
 
 /**
  * An optimized link-state routing protocol implementation
@@ -31,6 +37,10 @@ public:
      * Starts sending hello messages and performing other network operations
      */
     virtual void Start() override;
+    /**
+     * Stops sending messages and clears all tables
+     */
+    virtual void Stop() override;
 
     /**
      * Sends a packet to the specified destination
@@ -43,6 +53,85 @@ public:
 
     IcaoAddress Address() const;
 
+    /**
+     * Enables or disables the compact Hello format
+     *
+     * Compact Hellos use a smaller encoding, and most of them contain only
+     * the neighbors that changed since the previous Hello.
+     */
+    void SetCompactHello(bool compact);
+    /**
+     * Sets the number of compact Hellos in each cycle that starts with a
+     * Hello containing all neighbors
+     */
+    void SetFullHelloInterval(unsigned int interval);
+    /**
+     * Sets the timing of topology control messages
+     *
+     * A topology control message is sent when the MPR selector set
+     * changes, but no sooner than min_interval after the previous one.
+     * If the set does not change, one is sent every refresh_interval.
+     * Topology table entries expire after two refresh intervals and one
+     * minute. This must be called before Start().
+     */
+    void SetTopologyControlIntervals(ns3::Time min_interval, ns3::Time refresh_interval);
+    /**
+     * Enables fisheye topology control with TTL scopes in increasing order,
+     * or disables it if scopes is empty
+     *
+     * Topology control messages use the first scope as their TTL, every
+     * second one uses the second scope, every fourth one uses the third
+     * scope, and so on. Topology table entries from farther away are kept
+     * for correspondingly longer. This must be called before Start().
+     */
+    void SetFisheyeScopes(std::vector<std::uint8_t> scopes);
+    /**
+     * Enables the link lifetime metric, or disables it if range is zero
+     *
+     * Hellos then carry the position and velocity of the sender, and each
+     * node predicts when the link to each neighbor will break, assuming
+     * constant velocities and the provided transmission range in meters.
+     * Multipoint relay selection prefers links that are predicted to last
+     * for two Hello intervals, routes do not use neighbors whose links are
+     * predicted to have broken, and topology control messages carry the
+     * lifetimes of links to MPR selectors so that the topology table keeps
+     * the longest-lived last hop to each destination.
+     */
+    void SetLinkLifetimeMetric(double range);
+    /**
+     * Makes this node a gateway, or an ordinary node
+     *
+     * A gateway, like an OLSR HNA announcement, marks its topology control
+     * messages with a gateway flag, sends them even if its MPR selector set
+     * is empty, and floods them to every node with the largest TTL, so
+     * that only duplicate detection stops them. Other nodes send packets to
+     * destinations without routes toward the nearest gateway.
+     */
+    void SetGateway(bool gateway);
+    /**
+     * Enables or disables keeping routes only to neighbors and gateways
+     *
+     * Routes to gateways are then found by following last hops in the
+     * topology table, without calculating routes to other destinations,
+     * and only changes to the entries that those routes depend on cause
+     * route updates. Other destinations are reached through the nearest
+     * gateway. This must be called before Start().
+     */
+    void SetGatewayRoutesOnly(bool gateway_routes_only);
+    /**
+     * Enables two-level clustered routing with cells of the provided size
+     * in degrees, or disables it if cell_size is zero
+     *
+     * Hellos then carry the position of the sender. Every node sends
+     * topology control messages, but they are only processed and forwarded
+     * within the cell of the originator. The messages of cluster heads and
+     * gateways also carry the cells next to their cells and are flooded
+     * to all nodes with the largest TTL. Nodes route packets for heads and
+     * gateways in other cells through the shortest path of cells. See
+     * ClusterTable. This must be called before Start().
+     */
+    void SetClusterCellSize(double cell_size);
+
     static ns3::TypeId GetTypeId();
 
     inline const NeighborTable& Neighbors() const {
@@ -57,6 +146,71 @@ public:
     inline const TopologyTable& Topology() const {
         return _topology;
     }
+    /** Returns the known gateways, and the times when their advertisements expire */
+    inline const util::FlatMap<IcaoAddress, ns3::Time>& Gateways() const {
+        return _gateways;
+    }
+    inline const ClusterTable& Clusters() const {
+        return _clusters;
+    }
+    /** Returns the cell of this node, if it uses clustered routing */
+    inline const boost::optional<ClusterTable::cell_type>& Cell() const {
+        return _cell;
+    }
+    inline bool IsClusterHead() const {
+        return _cluster_head;
+    }
+    /** Returns the nearest gateway that has a route, if any */
+    inline const boost::optional<IcaoAddress>& DefaultGateway() const {
+        return _default_gateway;
+    }
+    /** Returns the number of topology control messages that this node has originated */
+    inline std::uint64_t TopologyControlSent() const {
+        return _topology_control_sent;
+    }
+    /**
+     * Returns the number of topology control messages that this node has
+     * originated because its MPR selector set changed
+     */
+    inline std::uint64_t TopologyControlTriggered() const {
+        return _topology_control_triggered;
+    }
+    /**
+     * Returns the total size of the OLSR headers of topology control
+     * messages originated and forwarded, in bytes
+     */
+    inline std::uint64_t TopologyControlBytesSent() const {
+        return _topology_control_bytes_sent;
+    }
+    /** Returns the number of topology control messages that this node has forwarded */
+    inline std::uint64_t TopologyControlForwarded() const {
+        return _topology_control_forwarded;
+    }
+    /**
+     * Returns the number of topology control messages that this node has
+     * received more than once, and did not process or forward again
+     */
+    inline std::uint64_t TopologyControlSuppressed() const {
+        return _topology_control_suppressed;
+    }
+    /**
+     * Returns the number of topology control messages that were forgotten
+     * by the duplicate set before their hold time, so that copies received
+     * later were not suppressed
+     */
+    inline std::uint64_t DuplicateEvictions() const {
+        return _duplicates.LiveEvictions();
+    }
+
+    /** Returns the number of times that routes have been recalculated */
+    inline std::uint64_t RouteUpdates() const {
+        return _route_updates;
+    }
+
+    /** Returns the total size of the OLSR headers of Hello messages sent, in bytes */
+    inline std::uint64_t HelloBytesSent() const {
+        return _hello_bytes_sent;
+    }
 
     /** A wrapper that dumps the state of an OLSR instance */
     class DumpState {
@@ -77,24 +231,111 @@ private:
      */
     ns3::Time _hello_interval;
     /**
-     * Interval between topology control messages
+     * Interval between topology control messages when the MPR selector set
+     * does not change
      */
     ns3::Time _topology_control_interval;
+    /** Minimum interval between topology control messages */
+    ns3::Time _topology_control_min_interval;
+    /** Fisheye TTL scopes in increasing order, or empty to always use _default_ttl */
+    std::vector<std::uint8_t> _fisheye_scopes;
+    /** If true, Hello messages use the compact format */
+    bool _compact_hello;
+    /**
+     * Number of compact Hellos in each cycle, starting with one that
+     * contains all neighbors
+     */
+    unsigned int _full_hello_interval;
     /** Interval between Cleanup() calls */
     ns3::Time _cleanup_interval;
+    /**
+     * Maximum time between a change to the neighbor or topology tables and
+     * the recalculation of routes
+     */
+    ns3::Time _route_update_delay;
     /**
      * Default TTL to use when sending non-local messages
      */
     std::uint8_t _default_ttl;
+    /** Transmission range for link lifetime predictions, meters, or 0 if not used */
+    double _link_range;
+    /** If true, this node advertises itself as a gateway */
+    bool _gateway;
+    /** If true, only routes to neighbors and gateways are calculated */
+    bool _gateway_routes_only;
 
     /** Neighbor table */
     NeighborTable _neighbors;
+    /** Neighbors and states sent in the last compact Hello */
+    util::FlatMap<IcaoAddress, LinkState> _advertised;
+    /** Sequence number of the next compact Hello */
+    std::uint8_t _hello_sequence;
+    /** Number of compact Hellos sent since the last full one */
+    unsigned int _hellos_since_full;
+    /** Total size of Hello headers sent */
+    std::uint64_t _hello_bytes_sent;
     /** Table of neighbors that consider this node in their multipoint relay sets */
     MprTable _mpr_selector;
     /** Topology table */
     TopologyTable _topology;
     /** Routing table */
     RoutingTable _routing;
+    /** Gateway address -> time when its advertisement expires */
+    util::FlatMap<IcaoAddress, ns3::Time> _gateways;
+    /** The nearest gateway with a route, used for destinations without routes */
+    boost::optional<IcaoAddress> _default_gateway;
+    /**
+     * Addresses whose entries the routes to gateways depend on, if only
+     * routes to gateways are calculated
+     */
+    util::FlatSet<IcaoAddress> _gateway_path;
+    /** Cell size for clustered routing, degrees, or 0 if not used */
+    double _cell_size;
+    /** Cluster members, cells, and locations of heads and gateways */
+    ClusterTable _clusters;
+    /** The current cell of this node, if it uses clustered routing */
+    boost::optional<ClusterTable::cell_type> _cell;
+    /** True if this node is the head of its cluster */
+    bool _cluster_head;
+    /** Cells next to this node's cell, as sent in topology control messages */
+    ClusterTable::cell_set _adjacent_cells;
+    /**
+     * Addresses whose neighbor or topology entries have changed since routes
+     * were last calculated
+     */
+    std::set<IcaoAddress> _route_changes;
+    /** True if a batched route update has been registered and has not run */
+    bool _route_update_scheduled;
+    /** The time of the registered batched route update */
+    ns3::Time _route_update_time;
+    /** True if routes have been calculated and FinishRouteUpdate() has not run */
+    bool _routes_calculated;
+    /** Number of route recalculations */
+    std::uint64_t _route_updates;
+    /** MPR selector sequence number in the last topology control message sent */
+    std::uint8_t _topology_control_sequence;
+    /** Time when the last topology control message was sent */
+    ns3::Time _last_topology_control;
+    /** Scheduled SendTopologyControl() call for a changed MPR selector set, if any */
+    ns3::EventId _topology_control_event;
+    /** Scheduled HandleExpiredLinks() call at the earliest predicted link break, if any */
+    ns3::EventId _link_expiry_event;
+    /** Time of _link_expiry_event */
+    ns3::Time _link_expiry_time;
+    /** Time of the last HandleExpiredLinks() call */
+    ns3::Time _link_expiry_checked;
+    /** Topology control messages that have already been handled */
+    DuplicateSet _duplicates;
+    /** Number of topology control messages originated */
+    std::uint64_t _topology_control_sent;
+    /** Number of topology control messages originated because of changes */
+    std::uint64_t _topology_control_triggered;
+    /** Total size of topology control headers originated and forwarded */
+    std::uint64_t _topology_control_bytes_sent;
+    /** Number of topology control messages forwarded */
+    std::uint64_t _topology_control_forwarded;
+    /** Number of duplicate topology control messages received */
+    std::uint64_t _topology_control_suppressed;
 
     /** Data receive callback */
     receive_callback _receive_callback;
@@ -105,6 +346,18 @@ private:
      * The packet should include headers with address information.
      */
     void OnPacketReceived(ns3::Packet packet);
+    /**
+     * Forwards a data packet without parsing its whole OLSR header, if it
+     * is a data packet for another node with a non-zero TTL
+     *
+     * The 8-byte DataForwardHeader prefix is removed and added back with
+     * a decremented TTL, because ns3::Packet can't change bytes in place.
+     * The mesh header is written again by MeshNetDevice::Send(). Returns
+     * true if the packet was handled, or false with the packet unchanged.
+     *
+     * @param packet a packet without a mesh header
+     */
+    bool ForwardData(ns3::Packet& packet);
 
     /**
      * Sends a packet to a destination address
@@ -120,9 +373,35 @@ private:
     void SendHello();
 
     /**
-     * Sends a topology control message
+     * Creates a compact Hello message with all neighbors or the neighbors
+     * that changed since the last one, and records the neighbors sent
+     */
+    Message MakeCompactHello();
+
+    /**
+     * Sends a topology control message, if the MPR selector set is not
+     * empty
      */
     void SendTopologyControl();
+    /**
+     * Timer callback: Sends a topology control message unless one has been
+     * sent or scheduled recently
+     */
+    void RefreshTopologyControl();
+    /**
+     * Sends a topology control message if the MPR selector set has changed
+     * since the last one, or schedules it if one was sent too recently
+     */
+    void OnMprSelectorChanged();
+    /** Sends a topology control message for a changed MPR selector set */
+    void SendTriggeredTopologyControl();
+    /** Returns the TTL for the next topology control message */
+    std::uint8_t NextTopologyControlTtl() const;
+    /**
+     * Sets the topology table TTLs from the refresh interval and the
+     * fisheye scopes
+     */
+    void UpdateTopologyTtls();
 
     /**
      * Sends a packet to all of this node's multipoint relay neighbors
@@ -136,18 +415,108 @@ private:
     void SendWithHeader(ns3::Packet packet, IcaoAddress destination);
 
     /**
-     * Cleans up expired entries and recalculates routes
+     * Cleans up expired entries
      */
     void Cleanup();
 
+    /**
+     * Records that the neighbor or topology table entry for an address has
+     * changed, and registers a route update with the batch runner if one is
+     * not already registered
+     *
+     * Changes that happen within _route_update_delay are handled together,
+     * and the updates of all nodes due at the same time run in parallel.
+     */
+    void MarkRouteChanged(IcaoAddress address);
+    /**
+     * Returns true if a change to the entries for an address may change
+     * the routes that this node keeps
+     */
+    bool AffectsRoutes(IcaoAddress address) const;
+    /** Records a gateway flag from a topology control message */
+    void UpdateGateway(IcaoAddress originator, bool gateway);
+    /** Selects the nearest gateway with a route as the default */
+    void UpdateDefaultGateway();
+    /**
+     * Updates the cell, cluster head status, and adjacent cells of this
+     * node. Returns true if any of them changed.
+     */
+    bool UpdateClusterState();
+    /** Updates the cluster state, and advertises it if it changed */
+    void UpdateCluster();
+    /**
+     * Returns the cells of symmetric neighbors other than this node's cell,
+     * and for a cluster head the cells next to all members
+     */
+    ClusterTable::cell_set AdjacentCells() const;
+    /**
+     * Records the cluster information in a topology control message
+     *
+     * Returns true if the message comes from the cell of this node, so its
+     * MPR selectors should be added to the topology table.
+     */
+    bool HandleClusterInfo(const Message& message);
+    /**
+     * Returns the next hop toward a cluster head or gateway in another
+     * cell, if there is a path to it
+     */
+    boost::optional<IcaoAddress> ClusterNextHop(IcaoAddress destination);
+    /**
+     * Recalculates the routes affected by _route_changes, if any
+     *
+     * This is called when a packet needs a route before the batched update
+     * is due.
+     */
+    void UpdateRoutes();
+    /**
+     * Recalculates the routes affected by _route_changes, if any, using link
+     * lifetime predictions at a time
+     *
+     * This runs on a batch runner thread, so it only uses this node's tables
+     * and does not call ns-3 functions.
+     */
+    void CalculateRoutes(ns3::Time now);
+    /** Updates the state that depends on newly calculated routes */
+    void FinishRouteUpdate();
+
     /**
      * Handles a Hello message
      */
-    void HandleHello(IcaoAddress sender, const NeighborTable& neighbors);
-    void UpdateNeighbors(IcaoAddress sender, const NeighborTable& sender_neighbors);
-    void UpdateMprSelector(IcaoAddress sender, const NeighborTable& sender_neighbors);
+    void HandleHello(IcaoAddress sender, const Message& message);
+    /**
+     * Updates the entry for a neighbor that sent a Hello
+     *
+     * @param two_hop_neighbors the neighbors of the sender, other than this node
+     * @param advertised_state the link state that the sender reported for
+     * this node, if any
+     * @param sequence the sequence number of a compact Hello
+     */
+    void UpdateNeighbors(IcaoAddress sender, NeighborTableEntry::two_hop_set&& two_hop_neighbors,
+        const boost::optional<LinkState>& advertised_state, const boost::optional<std::uint8_t>& sequence);
+    void UpdateMprSelector(IcaoAddress sender, const boost::optional<LinkState>& advertised_state);
+    /** Selects multipoint relays from all neighbors */
+    void UpdateMultipointRelays();
+    /** Returns the position and velocity of this node, if it has a mobility model */
+    boost::optional<NodeMotion> LocalMotion() const;
+    /** Predicts when the link to a neighbor will break from the motion in its Hello */
+    void UpdateLinkExpiry(IcaoAddress sender, const NodeMotion& sender_motion);
+    /** Schedules HandleExpiredLinks() at a predicted link break, unless it is scheduled earlier */
+    void ScheduleLinkExpiry(ns3::Time expires);
+    /**
+     * Event callback: Updates routes and multipoint relays that use links
+     * predicted to have broken since the last call, and schedules the
+     * next call at the next predicted link break
+     */
+    void HandleExpiredLinks();
+    /**
+     * Returns the lifetime of the link to an MPR selector to send in
+     * topology control messages
+     */
+    std::uint8_t AdvertisedLinkLifetime(IcaoAddress selector) const;
 
     void HandleTopologyControl(IcaoAddress sender, Message&& message);
+    /** Forwards a topology control message to multipoint relays, if its TTL allows */
+    void ForwardTopologyControl(Message&& message);
     void HandleData(ns3::Packet packet, Message&& message);
 };
 
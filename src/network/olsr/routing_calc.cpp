@@ -1,57 +1,237 @@
 #include "routing_calc.h"
 #include <cassert>
+#include <deque>
 #include <limits>
+#include <unordered_set>
+#include <vector>
 #include <ns3/log.h>
 
 NS_LOG_COMPONENT_DEFINE("olsr::calculate_routes");
 
 namespace olsr {
 
-void calculate_routes(RoutingTable* routing, const NeighborTable& neighbors, const TopologyTable& topology) {
+namespace {
+
+/** Returns true if a neighbor is symmetric and its link is not predicted to have broken */
+bool is_usable(const NeighborTableEntry& entry, ns3::Time now) {
+    const auto state = entry.State();
+    return (state == LinkState::Bidirectional || state == LinkState::MultiPointRelay)
+        && entry.LinkExpires() > now;
+}
+
+/**
+ * Returns the first usable neighbor that reports a 2-hop neighbor, or
+ * nullptr if there is none
+ */
+const NeighborTableEntry* two_hop_next_hop(const NeighborTable& neighbors, IcaoAddress two_hop, ns3::Time now) {
+    for (const auto& address : neighbors.NeighborsReaching(two_hop)) {
+        const auto& neighbor_entry = neighbors.Find(address)->second;
+        if (is_usable(neighbor_entry, now)) {
+            return &neighbor_entry;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Adds routes to destinations that are reached through the routes in
+ * a queue, breadth-first
+ *
+ * Each destination in the topology table has one last hop, so the topology
+ * table forms a forest rooted at neighbors. A destination gets a route
+ * one hop longer than the route to its last hop, with the same next hop.
+ */
+void extend_routes(RoutingTable* routing, const TopologyTable& topology, std::deque<RoutingTable::Entry>&& queue) {
+    while (!queue.empty()) {
+        const auto from = queue.front();
+        queue.pop_front();
+        if (from.Distance() == std::numeric_limits<std::uint16_t>::max()) {
+            continue;
+        }
+        const auto dependents = topology.WithLastHop(from.Destination());
+        for (auto iter = dependents.first; iter != dependents.second; ++iter) {
+            const auto destination = iter->second;
+            if (routing->Find(destination) == routing->end()) {
+                NS_LOG_LOGIC("Adding " << from.Distance() + 1 << " distance route, next " << from.NextHop() << " to " << destination);
+                const RoutingTable::Entry entry(destination, from.NextHop(), static_cast<std::uint16_t>(from.Distance() + 1u));
+                routing->Insert(entry);
+                queue.push_back(entry);
+            }
+        }
+    }
+}
+
+}
+
+void calculate_routes(RoutingTable* routing, const NeighborTable& neighbors, const TopologyTable& topology, ns3::Time now) {
     assert(routing);
-    // Part 1: Reset
-    routing->clear();
-    // Part 2: Neighbors
+    // Routes are collected in breadth-first order and sorted into the
+    // routing table at the end. The vector is also the queue.
+    std::vector<RoutingTable::Entry> routes;
+    std::unordered_set<std::uint32_t> routed;
+    // Part 1: Neighbors
     for (const auto& entry : neighbors) {
         const auto& neighbor_entry = entry.second;
-        const auto address = neighbor_entry.Address();
-        const auto state = neighbor_entry.State();
-        if (state == LinkState::Bidirectional || state == LinkState::MultiPointRelay) {
+        if (is_usable(neighbor_entry, now)) {
+            const auto address = neighbor_entry.Address();
             NS_LOG_LOGIC("Adding 1-hop route to neighbor " << address);
             // Add a 1-hop route to this neighbor
-            RoutingTable::Entry entry(address, address, 1);
-            routing->Insert(entry);
+            routes.push_back(RoutingTable::Entry(address, address, 1));
+            routed.insert(address.Value());
+        }
+    }
+    // Part 2: 2-hop neighbors
+    for (const auto& entry : neighbors.TwoHopIndex()) {
+        const auto address = entry.first;
+        if (routed.count(address.Value()) != 0) {
+            continue;
+        }
+        const auto* next_hop = two_hop_next_hop(neighbors, address, now);
+        if (next_hop) {
+            NS_LOG_LOGIC("Adding 2-hop route, next " << next_hop->Address() << " to " << address);
+            routes.push_back(RoutingTable::Entry(address, next_hop->Address(), 2));
+            routed.insert(address.Value());
+        }
+    }
+    // Part 3: Other destinations
+    for (std::size_t i = 0; i < routes.size(); i++) {
+        const auto from = routes[i];
+        if (from.Distance() == std::numeric_limits<std::uint16_t>::max()) {
+            continue;
+        }
+        const auto dependents = topology.WithLastHop(from.Destination());
+        for (auto iter = dependents.first; iter != dependents.second; ++iter) {
+            const auto destination = iter->second;
+            if (routed.insert(destination.Value()).second) {
+                NS_LOG_LOGIC("Adding " << from.Distance() + 1 << " distance route, next " << from.NextHop() << " to " << destination);
+                routes.push_back(RoutingTable::Entry(destination, from.NextHop(), static_cast<std::uint16_t>(from.Distance() + 1u)));
+            }
         }
     }
-    // Part 3: Non-neighbors
-    for (std::uint16_t h = 1; h != std::numeric_limits<std::uint16_t>::max(); ++h) {
-        auto entry_added = false;
-
-        // Look in the topology table
-        for (const auto& topology_entry : topology) {
-            const auto dest_in_routing = routing->Find(topology_entry.Destination());
-            if (dest_in_routing == routing->end()) {
-                // Not in the routing table, look for a route to the last hop
-                const auto last_hop_in_routing = routing->Find(topology_entry.LastHop());
-                if (last_hop_in_routing != routing->end()) {
-                    if (last_hop_in_routing->Distance() == h) {
-                        // This is a new segment
-                        NS_LOG_LOGIC("Adding " << h + 1 << " distance route, next " << last_hop_in_routing->NextHop() << " to " << topology_entry.Destination());
-                        RoutingTable::Entry entry{
-                            topology_entry.Destination(),
-                            last_hop_in_routing->NextHop(),
-                            static_cast<std::uint16_t>(h + 1u)};
-                        routing->Insert(entry);
-                        entry_added = true;
-                    }
+    routing->Assign(std::move(routes));
+}
+
+void calculate_gateway_routes(RoutingTable* routing, const NeighborTable& neighbors, const TopologyTable& topology,
+    const std::vector<IcaoAddress>& gateways, util::FlatSet<IcaoAddress>* path, ns3::Time now) {
+    assert(routing);
+    std::vector<RoutingTable::Entry> routes;
+    if (path) {
+        path->clear();
+    }
+    // Part 1: Neighbors
+    for (const auto& entry : neighbors) {
+        const auto& neighbor_entry = entry.second;
+        if (is_usable(neighbor_entry, now)) {
+            routes.push_back(RoutingTable::Entry(neighbor_entry.Address(), neighbor_entry.Address(), 1));
+        }
+    }
+    // Part 2: Gateways, by walking last hops back toward this node
+    for (const auto& gateway : gateways) {
+        auto address = gateway;
+        // Each step adds one hop, and a route longer than the topology
+        // table has a loop
+        for (std::size_t hops = 0; hops <= topology.size(); hops++) {
+            if (path) {
+                // The route may change if any neighbor that reaches this
+                // address changes
+                path->insert(address);
+                for (const auto& reaching : neighbors.NeighborsReaching(address)) {
+                    path->insert(reaching);
                 }
             }
+            const auto in_neighbors = neighbors.Find(address);
+            if (in_neighbors != neighbors.end() && is_usable(in_neighbors->second, now)) {
+                if (address != gateway) {
+                    routes.push_back(RoutingTable::Entry(gateway, address, static_cast<std::uint16_t>(hops + 1)));
+                }
+                break;
+            }
+            const auto* next_hop = two_hop_next_hop(neighbors, address, now);
+            if (next_hop) {
+                NS_LOG_LOGIC("Adding " << hops + 2 << " distance route, next " << next_hop->Address() << " to gateway " << gateway);
+                routes.push_back(RoutingTable::Entry(gateway, next_hop->Address(), static_cast<std::uint16_t>(hops + 2)));
+                break;
+            }
+            const auto in_topology = topology.Find(address);
+            if (in_topology == topology.end()) {
+                break;
+            }
+            address = in_topology->LastHop();
         }
+    }
+    routing->Assign(std::move(routes));
+}
 
-        if (!entry_added) {
-            break;
+void update_routes(RoutingTable* routing, const NeighborTable& neighbors, const TopologyTable& topology, const std::set<IcaoAddress>& changed,
+    ns3::Time now) {
+    assert(routing);
+    // Part 1: Find the changed destinations and all destinations reached through them
+    std::set<IcaoAddress> affected;
+    std::vector<IcaoAddress> to_visit(changed.begin(), changed.end());
+    while (!to_visit.empty()) {
+        const auto address = to_visit.back();
+        to_visit.pop_back();
+        if (affected.insert(address).second) {
+            const auto in_neighbors = neighbors.Find(address);
+            if (in_neighbors != neighbors.end()) {
+                const auto& two_hop_neighbors = in_neighbors->second.TwoHopNeighbors();
+                to_visit.insert(to_visit.end(), two_hop_neighbors.begin(), two_hop_neighbors.end());
+            }
+            const auto dependents = topology.WithLastHop(address);
+            for (auto iter = dependents.first; iter != dependents.second; ++iter) {
+                to_visit.push_back(iter->second);
+            }
+        }
+    }
+    NS_LOG_LOGIC("Updating routes to " << affected.size() << " destinations");
+    // Part 2: Remove their routes
+    for (const auto& address : affected) {
+        routing->Remove(address);
+    }
+    // Part 3: Neighbors
+    std::deque<RoutingTable::Entry> queue;
+    for (const auto& address : affected) {
+        const auto in_neighbors = neighbors.Find(address);
+        if (in_neighbors != neighbors.end() && is_usable(in_neighbors->second, now)) {
+            RoutingTable::Entry entry(address, address, 1);
+            routing->Insert(entry);
+            queue.push_back(entry);
+        }
+    }
+    // Part 4: 2-hop neighbors
+    for (const auto& address : affected) {
+        if (routing->Find(address) != routing->end()) {
+            continue;
+        }
+        const auto* next_hop = two_hop_next_hop(neighbors, address, now);
+        if (next_hop) {
+            RoutingTable::Entry entry(address, next_hop->Address(), 2);
+            routing->Insert(entry);
+            queue.push_back(entry);
         }
     }
+    // Part 5: Destinations whose last hops have unchanged routes
+    for (const auto& address : affected) {
+        if (routing->Find(address) != routing->end()) {
+            continue;
+        }
+        const auto in_topology = topology.Find(address);
+        if (in_topology == topology.end() || affected.count(in_topology->LastHop()) != 0) {
+            continue;
+        }
+        const auto last_hop_route = routing->Find(in_topology->LastHop());
+        if (last_hop_route != routing->end() && last_hop_route->Distance() != std::numeric_limits<std::uint16_t>::max()) {
+            RoutingTable::Entry entry(address, last_hop_route->NextHop(), static_cast<std::uint16_t>(last_hop_route->Distance() + 1u));
+            routing->Insert(entry);
+            queue.push_back(entry);
+        }
+    }
+    // Part 6: Destinations reached through those
+    extend_routes(routing, topology, std::move(queue));
+}
+
+bool route_logging_enabled() {
+    return g_log.IsEnabled(ns3::LOG_LOGIC);
 }
 
 }
@@ -1,6 +1,10 @@
 #ifndef NETWORK_OLSR_ROUTING_CALC_H
 #define NETWORK_OLSR_ROUTING_CALC_H
 
+#include <set>
+#include <vector>
+#include <ns3/nstime.h>
+#include "util/flat_map.h"
 #include "routing_table.h"
 #include "neighbor_table.h"
 #include "topology_table.h"
@@ -9,9 +13,63 @@ namespace olsr {
 
 /**
  * Updates a routing table based on the neighbors and topology
+ *
+ * Each 2-hop neighbor that is not a neighbor gets a 2-hop route through
+ * the first usable neighbor that reports it, found in the neighbor table
+ * 2-hop index. Other destinations are reached through their last hops in
+ * the topology table.
+ *
+ * Neighbors whose links are predicted to have broken by now are not used.
+ * The topology table has one last hop for each destination, which is
+ * already the one with the longest-lived link when the link lifetime
+ * metric is used.
+ *
  * @param routing a non-NULL pointer to a RoutingTable
+ * @param now the current time, or zero to ignore link lifetime predictions
  */
-void calculate_routes(RoutingTable* routing, const NeighborTable& neighbors, const TopologyTable& topology);
+void calculate_routes(RoutingTable* routing, const NeighborTable& neighbors, const TopologyTable& topology, ns3::Time now = ns3::Time());
+
+/**
+ * Updates the routes in a routing table that may have changed since it was
+ * last calculated
+ *
+ * The result is the same as calculate_routes(), but only the routes to
+ * changed addresses and to destinations reached through them are
+ * recalculated.
+ *
+ * @param routing a non-NULL pointer to a RoutingTable
+ * @param changed the addresses whose neighbor or topology table entries have
+ * been added, removed, or changed
+ */
+void update_routes(RoutingTable* routing, const NeighborTable& neighbors, const TopologyTable& topology, const std::set<IcaoAddress>& changed,
+    ns3::Time now = ns3::Time());
+
+/**
+ * Replaces the routes in a routing table with routes to neighbors and to
+ * gateways only
+ *
+ * The route to each gateway is found by following last hops in the
+ * topology table back to a neighbor or 2-hop neighbor, so the routes are
+ * the same as those from calculate_routes() without visiting other
+ * destinations.
+ *
+ * @param routing a non-NULL pointer to a RoutingTable
+ * @param gateways the gateway addresses, in increasing order
+ * @param path if not NULL, set to the addresses whose neighbor or topology
+ * table entries the gateway routes depend on. Changes to the entries of
+ * other addresses do not change the gateway routes.
+ * @param now the current time, or zero to ignore link lifetime predictions
+ */
+void calculate_gateway_routes(RoutingTable* routing, const NeighborTable& neighbors, const TopologyTable& topology,
+    const std::vector<IcaoAddress>& gateways, util::FlatSet<IcaoAddress>* path, ns3::Time now = ns3::Time());
+
+/**
+ * Returns true if the functions above log their steps
+ *
+ * ns-3 logging is not thread-safe, so they must then only run on one
+ * thread at a time.
+ */
+bool route_logging_enabled();
 
 }
 
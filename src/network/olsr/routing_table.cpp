@@ -9,11 +9,53 @@ RoutingTable::Entry::Entry(IcaoAddress destination, IcaoAddress next_hop, std::u
 {
 }
 
-RoutingTable::iterator RoutingTable::Find(IcaoAddress destination) {
-    return iterator(_table.find(destination));
+RoutingTable::RoutingTable() :
+    _table(std::make_shared<map_type>()),
+    _version(0)
+{
+}
+
+RoutingTable::map_type& RoutingTable::Modify() {
+    if (_table.use_count() > 1) {
+        _table = std::make_shared<map_type>(*_table);
+    }
+    _version++;
+    return *_table;
+}
+
+void RoutingTable::clear() {
+    if (!_table->empty()) {
+        // Start new storage instead of copying shared entries
+        _table = std::make_shared<map_type>();
+        _version++;
+    }
+}
+
+RoutingTable::const_iterator RoutingTable::Find(IcaoAddress destination) const {
+    return const_iterator(_table->find(destination));
 }
 void RoutingTable::Insert(Entry entry) {
-    _table.insert(std::make_pair(entry.Destination(), entry));
+    if (_table->find(entry.Destination()) == _table->end()) {
+        Modify().insert(std::make_pair(entry.Destination(), entry));
+    }
+}
+void RoutingTable::Remove(IcaoAddress destination) {
+    if (_table->find(destination) != _table->end()) {
+        Modify().erase(destination);
+    }
+}
+void RoutingTable::Assign(std::vector<Entry>&& entries) {
+    std::vector<std::pair<IcaoAddress, Entry>> items;
+    items.reserve(entries.size());
+    for (const auto& entry : entries) {
+        items.push_back(std::make_pair(entry.Destination(), entry));
+    }
+    auto table = std::make_shared<map_type>();
+    table->assign(std::move(items));
+    if (*table != *_table) {
+        _table = std::move(table);
+        _version++;
+    }
 }
 
 
@@ -3,13 +3,19 @@
 
 #include "address/icao_address.h"
 #include "util/value_iterator.h"
+#include "util/flat_map.h"
 #include <cstdint>
-#include <map>
+#include <memory>
+#include <vector>
 
 namespace olsr {
 
 /**
  * OLSR routing table
+ *
+ * The entries are stored in shared storage that is copied when it is
+ * modified while other tables still refer to it. Copying a table is cheap,
+ * and gives a snapshot that does not change when the original does.
  */
 class RoutingTable {
 public:
@@ -33,6 +39,9 @@ public:
         inline std::uint16_t Distance() const {
             return _distance;
         }
+        friend inline bool operator == (const Entry& a, const Entry& b) {
+            return a._destination == b._destination && a._next_hop == b._next_hop && a._distance == b._distance;
+        }
     };
 
     /** An adapter that prints the routing table to a stream */
@@ -44,40 +53,67 @@ public:
         friend std::ostream& operator << (std::ostream& stream, const PrintTable& pt);
     };
 private:
-    typedef std::map<IcaoAddress, Entry>::iterator underlying_iterator;
-    typedef std::map<IcaoAddress, Entry>::const_iterator underlying_const_iterator;
+    typedef util::FlatMap<IcaoAddress, Entry> map_type;
+    typedef map_type::const_iterator underlying_const_iterator;
 public:
-    typedef util::ValueIterator<underlying_iterator> iterator;
+    /** Entries can only be changed through the table, so all iterators are const */
+    typedef util::ConstValueIterator<underlying_const_iterator> iterator;
     typedef util::ConstValueIterator<underlying_const_iterator> const_iterator;
 
+    RoutingTable();
+
     inline std::size_t size() const {
-        return _table.size();
+        return _table->size();
     }
 
-    inline iterator begin() {
-        return iterator(_table.begin());
-    }
-    inline iterator end() {
-        return iterator(_table.end());
-    }
     inline const_iterator begin() const {
-        return const_iterator(_table.begin());
+        return const_iterator(_table->begin());
     }
     inline const_iterator end() const {
-        return const_iterator(_table.end());
-    }
-    inline void clear() {
-        _table.clear();
+        return const_iterator(_table->end());
     }
+    void clear();
 
-    iterator Find(IcaoAddress destination);
+    const_iterator Find(IcaoAddress destination) const;
+    /** Adds an entry, if no entry for its destination exists */
     void Insert(Entry entry);
+    /** Removes the entry for a destination, if one exists */
+    void Remove(IcaoAddress destination);
+    /**
+     * Replaces all entries with entries in any order
+     *
+     * If several entries have the same destination, the first one is kept.
+     * If the result is the same as the current entries, this table is not
+     * changed and its version stays the same.
+     */
+    void Assign(std::vector<Entry>&& entries);
+
+    /**
+     * Returns the version of this table, which increases each time its
+     * entries change
+     *
+     * A copy of a table has the same version until either table changes.
+     */
+    inline std::uint64_t Version() const {
+        return _version;
+    }
 
 private:
     /**
      * Table with a mapping from destination address to entry
+     *
+     * This may be shared with copies of this table, and must not be
+     * modified except through Modify().
+     */
+    std::shared_ptr<map_type> _table;
+    /** Number of changes to the entries */
+    std::uint64_t _version;
+
+    /**
+     * Prepares to change the entries: copies the storage if other tables
+     * share it, and increments the version
      */
-    std::map<IcaoAddress, Entry> _table;
+    map_type& Modify();
 };
 
 }
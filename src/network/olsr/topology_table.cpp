@@ -1,16 +1,19 @@
 #include "topology_table.h"
 #include <ns3/simulator.h>
 #include <ns3/log.h>
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE("olsr::TopologyTable");
 
 namespace olsr {
 
-TopologyTable::Entry::Entry(IcaoAddress destination, IcaoAddress last_hop, std::uint8_t sequence) :
+TopologyTable::Entry::Entry(IcaoAddress destination, IcaoAddress last_hop, std::uint8_t sequence, std::uint8_t distance) :
     _destination(destination),
     _last_hop(last_hop),
     _sequence(sequence),
-    _updated(ns3::Simulator::Now())
+    _updated(ns3::Simulator::Now()),
+    _distance(distance),
+    _link_expires(ns3::Time::Max())
 {
 }
 
@@ -20,34 +23,87 @@ void TopologyTable::Entry::MarkSeen() {
 
 TopologyTable::TopologyTable(ns3::Time ttl) :
     _table(),
-    _ttl(ttl)
+    _by_last_hop(),
+    _ttl(ttl),
+    _distance_ttls(),
+    _expiry()
 {
 }
 
+ns3::Time TopologyTable::Ttl(std::uint8_t distance) const {
+    if (distance != 0 && distance <= _distance_ttls.size()) {
+        return _distance_ttls[distance - 1];
+    }
+    return _ttl;
+}
+
 TopologyTable::iterator TopologyTable::Find(IcaoAddress destination) {
     return iterator(_table.find(destination));
 }
+TopologyTable::const_iterator TopologyTable::Find(IcaoAddress destination) const {
+    return const_iterator(_table.find(destination));
+}
 
 void TopologyTable::Insert(Entry entry) {
-    _table.insert(std::make_pair(entry.Destination(), entry));
+    const auto inserted = _table.insert(std::make_pair(entry.Destination(), entry));
+    if (inserted.second) {
+        _by_last_hop.insert(std::make_pair(entry.LastHop(), entry.Destination()));
+        _expiry.Push(entry.Destination(), entry.Updated() + Ttl(entry.Distance()));
+    }
 }
 
 void TopologyTable::Remove(iterator position) {
+    _by_last_hop.erase(std::make_pair(position->LastHop(), position->Destination()));
     _table.erase(position.inner());
 }
 
-void TopologyTable::RemoveExpired() {
+void TopologyTable::clear() {
+    _table.clear();
+    _by_last_hop.clear();
+    _expiry.clear();
+}
+
+void TopologyTable::SetLastHop(iterator position, IcaoAddress last_hop) {
+    _by_last_hop.erase(std::make_pair(position->LastHop(), position->Destination()));
+    position->_last_hop = last_hop;
+    _by_last_hop.insert(std::make_pair(last_hop, position->Destination()));
+}
+
+void TopologyTable::SetDistance(iterator position, std::uint8_t distance) {
+    position->_distance = distance;
+    // Moves the entry earlier in the queue if its TTL is now shorter
+    _expiry.Push(position->Destination(), position->Updated() + Ttl(distance));
+}
+
+std::pair<TopologyTable::last_hop_iterator, TopologyTable::last_hop_iterator> TopologyTable::WithLastHop(IcaoAddress last_hop) const {
+    // IcaoAddress() is the lowest address and the broadcast address is the highest
+    const auto start = std::lower_bound(_by_last_hop.begin(), _by_last_hop.end(), std::make_pair(last_hop, IcaoAddress()));
+    const auto end = std::upper_bound(start, _by_last_hop.end(), std::make_pair(last_hop, IcaoAddress::Broadcast()));
+    return std::make_pair(start, end);
+}
+
+void TopologyTable::RemoveExpired(std::vector<IcaoAddress>* removed) {
     const auto now = ns3::Simulator::Now();
-    for (auto iter = _table.begin(); iter != _table.end(); /* nothing */) {
-        const auto age = now - iter->second.Updated();
-        if (age > _ttl) {
-            NS_LOG_LOGIC("TopologyTable removing expired entry to " << iter->second.Destination());
-            const auto to_remove = iter;
-            ++iter;
-            _table.erase(to_remove);
+    std::vector<IcaoAddress> expired;
+    _expiry.PopBefore(now, [&](IcaoAddress destination) {
+        const auto entry = _table.find(destination);
+        if (entry == _table.end()) {
+            // Already removed
+            return;
+        }
+        const auto expires = entry->second.Updated() + Ttl(entry->second.Distance());
+        if (expires < now) {
+            NS_LOG_LOGIC("TopologyTable removing expired entry to " << destination);
+            _by_last_hop.erase(std::make_pair(entry->second.LastHop(), destination));
+            expired.push_back(destination);
         } else {
-            ++iter;
+            _expiry.Push(destination, expires);
         }
+    });
+    std::sort(expired.begin(), expired.end());
+    _table.erase_keys(expired.begin(), expired.end());
+    if (removed) {
+        removed->insert(removed->end(), expired.begin(), expired.end());
     }
 }
 
@@ -57,11 +113,12 @@ TopologyTable::PrintTable::PrintTable(const TopologyTable& table) :
 }
 std::ostream& operator << (std::ostream& stream, const TopologyTable::PrintTable& pt) {
     const auto& table = pt._table;
-    stream << "| Destination | Last hop | Sequence |\n";
+    stream << "| Destination | Last hop | Sequence | Distance |\n";
     for (const auto& entry : table) {
         stream << " " << entry.Destination()
             << " | " << entry.LastHop()
-            << " | " << static_cast<unsigned int>(entry.Sequence()) << " |\n";
+            << " | " << static_cast<unsigned int>(entry.Sequence())
+            << " | " << static_cast<unsigned int>(entry.Distance()) << " |\n";
     }
     return stream;
 }
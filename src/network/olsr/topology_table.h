@@ -2,9 +2,12 @@
 #define NETWORK_OLSR_TOPOLOGY_TABLE_H
 #include "address/icao_address.h"
 #include "util/value_iterator.h"
+#include "util/flat_map.h"
+#include "util/expiry_queue.h"
 #include <ns3/nstime.h>
 #include <cstdint>
-#include <map>
+#include <utility>
+#include <vector>
 
 namespace olsr {
 
@@ -20,24 +23,42 @@ public:
         std::uint8_t _sequence;
         /** The time when this entry was last updated */
         ns3::Time _updated;
+        /**
+         * The number of hops from this node to the last hop, when the last
+         * topology control message was received
+         */
+        std::uint8_t _distance;
+        /**
+         * The time when the link from the last hop to the destination is
+         * predicted to break, or ns3::Time::Max() if there is no prediction
+         */
+        ns3::Time _link_expires;
     public:
-        Entry(IcaoAddress destination, IcaoAddress last_hop, std::uint8_t sequence);
+        Entry(IcaoAddress destination, IcaoAddress last_hop, std::uint8_t sequence, std::uint8_t distance = 1);
         inline IcaoAddress Destination() const {
             return _destination;
         }
         inline IcaoAddress LastHop() const {
             return _last_hop;
         }
-        inline void SetLastHop(IcaoAddress last_hop) {
-            _last_hop = last_hop;
-        }
         inline std::uint8_t Sequence() const {
             return _sequence;
         }
         inline ns3::Time Updated() const {
             return _updated;
         }
+        inline std::uint8_t Distance() const {
+            return _distance;
+        }
+        inline ns3::Time LinkExpires() const {
+            return _link_expires;
+        }
+        inline void SetLinkExpires(ns3::Time expires) {
+            _link_expires = expires;
+        }
         void MarkSeen();
+
+        friend class TopologyTable;
     };
     /** An adapter that displays the topology table */
     class PrintTable {
@@ -48,12 +69,14 @@ public:
         friend std::ostream& operator << (std::ostream& stream, const PrintTable& pt);
     };
 private:
-    typedef std::map<IcaoAddress, Entry>::iterator underlying_iterator;
-    typedef std::map<IcaoAddress, Entry>::const_iterator underlying_const_iterator;
+    typedef util::FlatMap<IcaoAddress, Entry>::iterator underlying_iterator;
+    typedef util::FlatMap<IcaoAddress, Entry>::const_iterator underlying_const_iterator;
 public:
 
     typedef util::ValueIterator<underlying_iterator> iterator;
     typedef util::ConstValueIterator<underlying_const_iterator> const_iterator;
+    /** An iterator over (last hop, destination) pairs, sorted by last hop */
+    typedef util::FlatSet<std::pair<IcaoAddress, IcaoAddress>>::const_iterator last_hop_iterator;
 
     TopologyTable(ns3::Time ttl = ns3::Minutes(5));
 
@@ -72,18 +95,59 @@ public:
     inline std::size_t size() const {
         return _table.size();
     }
+    /** Sets the time before entries expire. This must be called before entries are inserted. */
+    inline void SetTtl(ns3::Time ttl) {
+        _ttl = ttl;
+    }
+    /**
+     * Sets the time before entries expire by distance
+     *
+     * Element i applies to entries with distance i + 1. Entries farther
+     * away than the last element use the TTL from SetTtl(). This must be
+     * called before entries are inserted.
+     */
+    inline void SetDistanceTtls(std::vector<ns3::Time> ttls) {
+        _distance_ttls = std::move(ttls);
+    }
+    /** Returns the time before an entry with a distance expires */
+    ns3::Time Ttl(std::uint8_t distance) const;
 
     iterator Find(IcaoAddress destination);
+    const_iterator Find(IcaoAddress destination) const;
     void Insert(Entry entry);
     void Remove(iterator position);
+    /** Removes all entries */
+    void clear();
+    /** Changes the last hop of an entry */
+    void SetLastHop(iterator position, IcaoAddress last_hop);
+    /** Changes the distance of an entry */
+    void SetDistance(iterator position, std::uint8_t distance);
+
+    /**
+     * Returns the range of (last hop, destination) pairs for all entries
+     * with the provided last hop
+     */
+    std::pair<last_hop_iterator, last_hop_iterator> WithLastHop(IcaoAddress last_hop) const;
 
-    void RemoveExpired();
+    /**
+     * Removes expired entries
+     *
+     * @param removed if not NULL, the destinations of removed entries are
+     * appended to this vector
+     */
+    void RemoveExpired(std::vector<IcaoAddress>* removed = nullptr);
 
 private:
     /** Maps from destination address to Entry */
-    std::map<IcaoAddress, Entry> _table;
+    util::FlatMap<IcaoAddress, Entry> _table;
+    /** (last hop, destination) for each entry, used to find the entries that depend on a node */
+    util::FlatSet<std::pair<IcaoAddress, IcaoAddress>> _by_last_hop;
     /** Expiration time for entries */
     ns3::Time _ttl;
+    /** Expiration times for entries by distance, starting at distance 1 */
+    std::vector<ns3::Time> _distance_ttls;
+    /** Destinations of entries in the order of their expiry times */
+    util::ExpiryQueue<IcaoAddress> _expiry;
 };
 
 }
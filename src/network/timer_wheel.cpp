@@ -0,0 +1,216 @@
+#include "timer_wheel.h"
+#include <cassert>
+#include <limits>
+#include <ns3/simulator.h>
+#include <ns3/log.h>
+
+NS_LOG_COMPONENT_DEFINE("TimerWheel");
+
+TimerWheel::TimerWheel(ns3::Time resolution) :
+    _resolution(resolution),
+    _timers(),
+    _free(),
+    _slots(level_count * slot_count),
+    _active(0),
+    _current(0),
+    _event(),
+    _event_tick(0),
+    _running(false),
+    _random(ns3::CreateObject<ns3::UniformRandomVariable>()),
+    _ticks_run(0),
+    _calls(0),
+    _peak_calls(0)
+{
+    assert(_resolution.IsStrictlyPositive());
+    _current = NowTicks();
+}
+
+TimerWheel::~TimerWheel() {
+    ns3::Simulator::Cancel(_event);
+}
+
+TimerWheel& TimerWheel::Default() {
+    // Never destroyed, so that it is still valid when other static objects
+    // are destroyed
+    static TimerWheel* wheel = new TimerWheel();
+    return *wheel;
+}
+
+TimerWheel::TimerId TimerWheel::Register(ns3::Time first_delay, ns3::Time period, callback function, ns3::Time jitter,
+    ns3::Ptr<ns3::UniformRandomVariable> random) {
+    const auto now = NowTicks();
+    if (!_running && now > _current) {
+        // No timers are due before _event, so nothing needs to move
+        _current = now;
+    }
+    Timer timer;
+    timer.function = std::move(function);
+    timer.period = std::max(ToTicks(period), std::uint64_t(1));
+    timer.jitter = std::min(ToTicks(jitter), timer.period - 1);
+    timer.random = random ? random : _random;
+    timer.nominal = std::max(ToTicks(ns3::Simulator::Now() + first_delay), _current + 1);
+    timer.expires = timer.nominal;
+    timer.canceled = false;
+
+    TimerId id;
+    if (!_free.empty()) {
+        id = _free.back();
+        _free.pop_back();
+        _timers[id] = std::move(timer);
+    } else {
+        id = _timers.size();
+        _timers.push_back(std::move(timer));
+    }
+    _active++;
+    Insert(id);
+    if (!_running) {
+        ScheduleNext();
+    }
+    return id;
+}
+
+void TimerWheel::Cancel(TimerId id) {
+    assert(id < _timers.size());
+    auto& timer = _timers[id];
+    if (!timer.canceled) {
+        // The timer is removed from its slot later
+        timer.canceled = true;
+        _active--;
+    }
+}
+
+std::uint64_t TimerWheel::ToTicks(ns3::Time time) const {
+    const auto steps = time.GetTimeStep();
+    const auto resolution = _resolution.GetTimeStep();
+    if (steps <= 0) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>((steps + resolution - 1) / resolution);
+}
+
+std::uint64_t TimerWheel::NowTicks() const {
+    return static_cast<std::uint64_t>(ns3::Simulator::Now().GetTimeStep() / _resolution.GetTimeStep());
+}
+
+std::vector<TimerWheel::TimerId>& TimerWheel::Slot(unsigned int level, std::uint64_t index) {
+    return _slots[level * slot_count + (index & (slot_count - 1))];
+}
+
+void TimerWheel::Insert(TimerId id) {
+    const auto expires = _timers[id].expires;
+    assert(expires >= _current);
+    const auto delta = expires - _current;
+    for (unsigned int level = 0; level < level_count; level++) {
+        const auto shift = slot_bits * level;
+        if (delta < (slot_count << shift)) {
+            Slot(level, expires >> shift).push_back(id);
+            return;
+        }
+    }
+    // Beyond the top level: wait in the last slot that the top level can
+    // reach, and move down from there later
+    const auto shift = slot_bits * (level_count - 1);
+    Slot(level_count - 1, (_current >> shift) + slot_count).push_back(id);
+}
+
+void TimerWheel::Free(TimerId id) {
+    auto& timer = _timers[id];
+    timer.function = callback();
+    timer.random = ns3::Ptr<ns3::UniformRandomVariable>();
+    _free.push_back(id);
+}
+
+void TimerWheel::Cascade(unsigned int level) {
+    auto& slot = Slot(level, _current >> (slot_bits * level));
+    std::vector<TimerId> ids;
+    ids.swap(slot);
+    for (const auto id : ids) {
+        if (_timers[id].canceled) {
+            Free(id);
+        } else {
+            Insert(id);
+        }
+    }
+}
+
+std::uint64_t TimerWheel::NextTick() const {
+    auto next = std::numeric_limits<std::uint64_t>::max();
+    for (unsigned int level = 0; level < level_count; level++) {
+        const auto shift = slot_bits * level;
+        const auto current_index = _current >> shift;
+        // Slots after the current one, in order. At level 0 the current slot
+        // is never used again; at higher levels it is used for the tick
+        // when the level wraps around.
+        for (std::uint64_t offset = 1; offset <= slot_count; offset++) {
+            const auto index = current_index + offset;
+            if (!_slots[level * slot_count + (index & (slot_count - 1))].empty()) {
+                next = std::min(next, index << shift);
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+void TimerWheel::ScheduleNext() {
+    const auto next = NextTick();
+    if (_event.IsRunning()) {
+        if (_event_tick == next) {
+            return;
+        }
+        ns3::Simulator::Cancel(_event);
+    }
+    if (next == std::numeric_limits<std::uint64_t>::max()) {
+        return;
+    }
+    _event_tick = next;
+    const auto delay = _resolution * static_cast<std::int64_t>(next) - ns3::Simulator::Now();
+    _event = ns3::Simulator::Schedule(delay, &TimerWheel::RunTick, this);
+}
+
+void TimerWheel::RunTick() {
+    NS_LOG_FUNCTION(this << _event_tick);
+    _current = _event_tick;
+    _running = true;
+    // Move timers down from higher levels whose slots start at this tick
+    for (unsigned int level = level_count - 1; level > 0; level--) {
+        const auto mask = (std::uint64_t(1) << (slot_bits * level)) - 1;
+        if ((_current & mask) == 0) {
+            Cascade(level);
+        }
+    }
+
+    std::vector<TimerId> due;
+    due.swap(Slot(0, _current));
+    std::uint64_t calls = 0;
+    for (const auto id : due) {
+        if (_timers[id].canceled) {
+            Free(id);
+            continue;
+        }
+        calls++;
+        assert(_timers[id].expires == _current);
+        // The function may register more timers, which can move _timers
+        auto function = std::move(_timers[id].function);
+        function();
+        auto& timer = _timers[id];
+        timer.function = std::move(function);
+        if (timer.canceled) {
+            Free(id);
+            continue;
+        }
+        timer.nominal += timer.period;
+        timer.expires = timer.nominal;
+        if (timer.jitter != 0) {
+            timer.expires += timer.random->GetInteger(0, static_cast<std::uint32_t>(timer.jitter));
+        }
+        Insert(id);
+    }
+    if (calls != 0) {
+        _ticks_run++;
+        _calls += calls;
+        _peak_calls = std::max(_peak_calls, calls);
+    }
+    _running = false;
+    ScheduleNext();
+}
@@ -0,0 +1,154 @@
+#ifndef NETWORK_TIMER_WHEEL_H
+#define NETWORK_TIMER_WHEEL_H
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <ns3/nstime.h>
+#include <ns3/event-id.h>
+#include <ns3/random-variable-stream.h>
+
+/**
+ * A hierarchical timing wheel that runs periodic callbacks
+ *
+ * Instead of each protocol instance keeping its own chain of scheduled
+ * events, protocols register periodic callbacks here. The wheel keeps one
+ * ns-3 event, scheduled for the next tick that has callbacks due, and runs
+ * all of them from that event.
+ *
+ * Times are measured in ticks of a fixed resolution. Each of the levels has
+ * 64 slots, and each slot of a level covers 64 times as many ticks as a
+ * slot of the level below. Timers move to lower levels as their times
+ * approach, and run from the lowest level. Times are rounded up to the next
+ * tick.
+ */
+class TimerWheel {
+public:
+    typedef std::function<void()> callback;
+    /** Identifies a registered timer. Identifiers of canceled timers may be reused. */
+    typedef std::size_t TimerId;
+
+    /**
+     * Creates a timer wheel
+     *
+     * @param resolution the length of a tick
+     */
+    TimerWheel(ns3::Time resolution = ns3::MilliSeconds(100));
+    ~TimerWheel();
+    TimerWheel(const TimerWheel& other) = delete;
+    TimerWheel& operator = (const TimerWheel& other) = delete;
+
+    /** Returns the timer wheel that network protocols use */
+    static TimerWheel& Default();
+
+    /**
+     * Registers a function to be called periodically
+     *
+     * @param first_delay the time from now until the first call
+     * @param period the time between calls
+     * @param function the function to call
+     * @param jitter the maximum random delay added to each call. This does
+     * not delay later calls. It is limited to less than the period.
+     * @param random the source of jitter values, or null to use a source
+     * shared by all timers of this wheel
+     */
+    TimerId Register(ns3::Time first_delay, ns3::Time period, callback function, ns3::Time jitter = ns3::Time(),
+        ns3::Ptr<ns3::UniformRandomVariable> random = ns3::Ptr<ns3::UniformRandomVariable>());
+    /** Stops calling the function of a timer */
+    void Cancel(TimerId id);
+
+    /** Returns the number of timers that have not been canceled */
+    inline std::size_t size() const {
+        return _active;
+    }
+
+    /** Returns the number of ticks that have run timers */
+    inline std::uint64_t TicksRun() const {
+        return _ticks_run;
+    }
+    /** Returns the number of timer calls */
+    inline std::uint64_t Calls() const {
+        return _calls;
+    }
+    /** Returns the largest number of timer calls in one tick */
+    inline std::uint64_t PeakCalls() const {
+        return _peak_calls;
+    }
+
+private:
+    /** Number of bits of a tick number that select a slot in a level */
+    static const unsigned int slot_bits = 6;
+    static const std::uint64_t slot_count = 1 << slot_bits;
+    static const unsigned int level_count = 4;
+
+    struct Timer {
+        callback function;
+        /** Period, ticks */
+        std::uint64_t period;
+        /** Maximum jitter, ticks */
+        std::uint64_t jitter;
+        /** Source of jitter */
+        ns3::Ptr<ns3::UniformRandomVariable> random;
+        /** The tick of the current call without jitter */
+        std::uint64_t nominal;
+        /** The tick of the current call */
+        std::uint64_t expires;
+        /**
+         * True if this timer has been canceled. Its identifier can be reused
+         * after it is removed from its slot.
+         */
+        bool canceled;
+    };
+
+    /** The length of a tick */
+    ns3::Time _resolution;
+    /** Timers, indexed by identifier */
+    std::vector<Timer> _timers;
+    /** Identifiers that can be reused */
+    std::vector<TimerId> _free;
+    /** Identifiers of the timers in each slot, level by level */
+    std::vector<std::vector<TimerId>> _slots;
+    /** Number of timers that have not been canceled */
+    std::size_t _active;
+    /**
+     * The current tick
+     *
+     * No timers are due between this tick and the tick of _event.
+     */
+    std::uint64_t _current;
+    /** The event that runs the next due tick */
+    ns3::EventId _event;
+    /** The tick that _event runs */
+    std::uint64_t _event_tick;
+    /** True while timers are being run */
+    bool _running;
+    /** Jitter source for timers that do not have their own */
+    ns3::Ptr<ns3::UniformRandomVariable> _random;
+    /** Number of ticks that have run timers */
+    std::uint64_t _ticks_run;
+    /** Number of timer calls */
+    std::uint64_t _calls;
+    /** Largest number of timer calls in one tick */
+    std::uint64_t _peak_calls;
+
+    /** Converts a time to a number of ticks, rounding up */
+    std::uint64_t ToTicks(ns3::Time time) const;
+    /** Returns the current simulation time in ticks, rounding down */
+    std::uint64_t NowTicks() const;
+    /** Returns the slot for a level and slot index */
+    std::vector<TimerId>& Slot(unsigned int level, std::uint64_t index);
+
+    /** Places a timer in the slot for its expiry tick */
+    void Insert(TimerId id);
+    /** Releases a canceled timer that has been removed from its slot */
+    void Free(TimerId id);
+    /** Moves timers from a slot into lower levels */
+    void Cascade(unsigned int level);
+    /** Returns the next tick when a timer is due or a non-empty slot must cascade */
+    std::uint64_t NextTick() const;
+    /** Schedules _event for NextTick(), if any timers exist */
+    void ScheduleNext();
+    /** Event callback: Runs the timers due at _event_tick */
+    void RunTick();
+};
+
+#endif
@@ -39,6 +39,26 @@ void PacketRecorder::RecordPacketReceived(std::uint64_t id) {
     }
 }
 
+std::uint64_t PacketRecorder::Sent(PacketType type) const {
+    std::uint64_t count = 0;
+    for (const auto& pair : _table) {
+        if (pair.second.type == type) {
+            count++;
+        }
+    }
+    return count;
+}
+
+std::uint64_t PacketRecorder::Received(PacketType type) const {
+    std::uint64_t count = 0;
+    for (const auto& pair : _table) {
+        if (pair.second.type == type && pair.second.received) {
+            count++;
+        }
+    }
+    return count;
+}
+
 void PacketRecorder::WriteCsv(const std::string& path) const {
     std::ofstream file;
     file.exceptions(std::ios::badbit | std::ios::failbit);
@@ -65,6 +85,12 @@ std::ostream& operator << (std::ostream& stream, const PacketRecorder::PacketTyp
     case PacketRecorder::PacketType::Data:
         stream << "Data";
         break;
+    case PacketRecorder::PacketType::Hello:
+        stream << "Hello";
+        break;
+    case PacketRecorder::PacketType::TopologyControl:
+        stream << "TopologyControl";
+        break;
     }
     return stream;
 }
@@ -14,8 +14,13 @@ class PacketRecorder : public ns3::Object {
 public:
 
     enum class PacketType {
+        /** Management packets that do not have a more specific type */
         Management,
         Data,
+        /** OLSR Hello messages */
+        Hello,
+        /** OLSR topology control messages */
+        TopologyControl,
     };
 
     class Entry {
@@ -33,6 +38,11 @@ public:
     void RecordPacketSent(std::uint64_t id, PacketType type);
     void RecordPacketReceived(std::uint64_t id);
 
+    /** Returns the number of packets of a type that have been sent */
+    std::uint64_t Sent(PacketType type) const;
+    /** Returns the number of packets of a type that have been sent and received */
+    std::uint64_t Received(PacketType type) const;
+
     void WriteCsv(const std::string& path) const;
 
 private:
@@ -22,6 +22,10 @@ void NodeRecord::PrintJson(std::ostream& stream) const {
     stream << "{\"latitude\":" << latitude
         << ",\"longitude\":" << longitude
         << ",\"altitude\":" << altitude;
+    if (routing_unchanged) {
+        stream << ",\"routes_unchanged\":true}";
+        return;
+    }
     stream << ",\"routes\":[";
     bool first = true;
     for (const auto& route_entry : routing) {
@@ -40,7 +44,7 @@ Record::Record(ptime time) :
 }
 
 void Record::AddNode(IcaoAddress address, NodeRecord&& record) {
-    _nodes.insert(std::make_pair(address, record));
+    _nodes.insert(std::make_pair(address, std::move(record)));
 }
 
 void Record::PrintJson(std::ostream& stream) const {
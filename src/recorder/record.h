@@ -16,7 +16,13 @@ public:
     double latitude;
     double longitude;
     double altitude;
+    /** A snapshot of the routing table, which shares storage with the original */
     olsr::RoutingTable routing;
+    /**
+     * True if the routing table is the same as in the previous record of
+     * this node. The routes are then not printed.
+     */
+    bool routing_unchanged;
     /** Prints this node record to a stream as JSON */
     void PrintJson(std::ostream& stream) const;
 };
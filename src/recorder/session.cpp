@@ -3,7 +3,7 @@
 namespace record {
 
 void Session::AddRecord(Record&& record) {
-    _records.push_back(record);
+    _records.push_back(std::move(record));
 }
 
 void Session::PrintJson(std::ostream& stream) const {
@@ -57,10 +57,29 @@ SessionRecorder::SessionRecorder(ptime simulation_start, ns3::Time interval, ns3
     _simulation_start(simulation_start),
     _interval(interval),
     _nodes(nodes),
-    _session()
+    _session(),
+    _routing_versions()
 {
 }
 
+void SessionRecorder::AddNode(ns3::Ptr<ns3::Node> node) {
+    _nodes.Add(node);
+}
+
+void SessionRecorder::RemoveNode(ns3::Ptr<ns3::Node> node) {
+    ns3::NodeContainer remaining;
+    for (auto iter = _nodes.Begin(); iter != _nodes.End(); ++iter) {
+        if (*iter != node) {
+            remaining.Add(*iter);
+        }
+    }
+    _nodes = remaining;
+    const auto net_device = node->GetObject<MeshNetDevice>();
+    if (net_device) {
+        _routing_versions.erase(net_device->GetAddress());
+    }
+}
+
 void SessionRecorder::Start() {
     // Run at the beginning of the simulation
     ns3::Simulator::Schedule(ns3::Time(), &SessionRecorder::RecordRecord, this);
@@ -83,15 +102,22 @@ void SessionRecorder::RecordRecord() {
         std::tie(latitude, longitude, altitude) = EcefToLla(pos_ecef);
         olsr::RoutingTable routing;
         if (olsr) {
+            // Shares the storage of the routing table
             routing = olsr->Routing();
         }
+        const auto address = net_device->GetAddress();
+        const auto previous_version = _routing_versions.find(address);
+        const auto routing_unchanged = previous_version != _routing_versions.end()
+            && previous_version->second == routing.Version();
+        _routing_versions[address] = routing.Version();
         auto node_record = NodeRecord {
             latitude,
             longitude,
             altitude,
-            routing
+            std::move(routing),
+            routing_unchanged
         };
-        record.AddNode(net_device->GetAddress(), std::move(node_record));
+        record.AddNode(address, std::move(node_record));
     }
     _session.AddRecord(std::move(record));
 
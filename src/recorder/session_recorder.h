@@ -4,6 +4,8 @@
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <ns3/nstime.h>
 #include <ns3/node-container.h>
+#include <cstdint>
+#include <map>
 
 namespace record {
 using boost::posix_time::ptime;
@@ -19,6 +21,8 @@ private:
     ns3::NodeContainer _nodes;
     /** The session being constructed */
     Session _session;
+    /** The routing table version of each node in the previous record */
+    std::map<IcaoAddress, std::uint64_t> _routing_versions;
 
     /** Records a record */
     void RecordRecord();
@@ -27,6 +31,10 @@ private:
 public:
     /** Creates a recorder */
     SessionRecorder(ptime simulation_start, ns3::Time interval, ns3::NodeContainer&& nodes);
+    /** Adds a node to record, for nodes created while the simulation is running */
+    void AddNode(ns3::Ptr<ns3::Node> node);
+    /** Stops recording a node, for nodes that leave the simulation */
+    void RemoveNode(ns3::Ptr<ns3::Node> node);
     /** Schedules recording */
     void Start();
 
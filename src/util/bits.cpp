@@ -16,4 +16,33 @@ void write_u24(ns3::Buffer::Iterator* dest, std::uint32_t bits) {
     dest->WriteU8(static_cast<std::uint8_t>(bits));
 }
 
+std::uint32_t read_varint(ns3::Buffer::Iterator* source) {
+    std::uint32_t value = 0;
+    for (unsigned int shift = 0; shift < 32; shift += 7) {
+        const auto byte = source->ReadU8();
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return value;
+}
+
+void write_varint(ns3::Buffer::Iterator* dest, std::uint32_t value) {
+    while (value >= 0x80) {
+        dest->WriteU8(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    dest->WriteU8(static_cast<std::uint8_t>(value));
+}
+
+std::uint32_t varint_size(std::uint32_t value) {
+    std::uint32_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
 }
@@ -16,6 +16,25 @@ std::uint32_t read_u24(ns3::Buffer::Iterator* source);
  */
 void write_u24(ns3::Buffer::Iterator* dest, std::uint32_t bits);
 
+/**
+ * Reads an unsigned variable-length integer from the provided iterator
+ * and returns it
+ *
+ * Each byte holds 7 bits of the value, least significant bits first. The
+ * high bit of each byte is set if more bytes follow.
+ */
+std::uint32_t read_varint(ns3::Buffer::Iterator* source);
+
+/**
+ * Writes an unsigned variable-length integer to the provided iterator
+ */
+void write_varint(ns3::Buffer::Iterator* dest, std::uint32_t value);
+
+/**
+ * Returns the number of bytes that write_varint() uses for a value
+ */
+std::uint32_t varint_size(std::uint32_t value);
+
 }
 
 #endif
@@ -0,0 +1,96 @@
+#ifndef UTIL_EXPIRY_QUEUE_H
+#define UTIL_EXPIRY_QUEUE_H
+#include <ns3/nstime.h>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/**
+ * A queue of table keys ordered by the time when their entries were last
+ * updated, or when they expire, used to find expired entries without
+ * visiting every entry
+ *
+ * Tables push a key when they insert an entry. Entries can be marked as
+ * seen without telling the queue: when a key reaches the front of the
+ * queue, the table checks the entry and either removes it or pushes the
+ * key again with the newer time. Each key is queued with one time, so
+ * removing expired entries costs about O(log n) for each entry that
+ * expired or was last queued more than one TTL ago, instead of O(n).
+ */
+template <typename K>
+class ExpiryQueue {
+public:
+    /**
+     * Adds a key, with the time when its entry was updated or expires
+     *
+     * If the key is already queued with an earlier or equal time, this does
+     * nothing. If it is queued with a later time, it is moved to the
+     * earlier time.
+     */
+    void Push(const K& key, ns3::Time time) {
+        const auto inserted = _queued.insert(std::make_pair(key, time));
+        if (!inserted.second) {
+            if (!(time < inserted.first->second)) {
+                return;
+            }
+            // The record with the later time stays in the heap and is
+            // skipped when it reaches the front
+            inserted.first->second = time;
+        }
+        _heap.push_back(std::make_pair(time, key));
+        std::push_heap(_heap.begin(), _heap.end(), Later());
+    }
+
+    /**
+     * Removes each key queued with a time before cutoff and calls a
+     * function with it
+     *
+     * The function can push the key again with a later time if its entry
+     * has been updated.
+     */
+    template <typename F>
+    void PopBefore(ns3::Time cutoff, F function) {
+        while (!_heap.empty() && _heap.front().first < cutoff) {
+            std::pop_heap(_heap.begin(), _heap.end(), Later());
+            const auto key = _heap.back().second;
+            const auto time = _heap.back().first;
+            _heap.pop_back();
+            const auto queued = _queued.find(key);
+            if (queued == _queued.end() || queued->second != time) {
+                // Replaced with an earlier time
+                continue;
+            }
+            _queued.erase(queued);
+            function(key);
+        }
+    }
+
+    inline std::size_t size() const {
+        return _queued.size();
+    }
+    inline void clear() {
+        _heap.clear();
+        _queued.clear();
+    }
+
+private:
+    typedef std::pair<ns3::Time, K> record;
+    /** Orders records so that the earliest time is at the front of the heap */
+    struct Later {
+        bool operator () (const record& a, const record& b) const {
+            return b.first < a.first;
+        }
+    };
+
+    /** (time, key) records in a binary heap */
+    std::vector<record> _heap;
+    /** The queued keys, and the time of the current record of each */
+    std::unordered_map<K, ns3::Time> _queued;
+};
+
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef UTIL_FLAT_MAP_H
+#define UTIL_FLAT_MAP_H
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/**
+ * A map stored as a vector of (key, value) pairs sorted by key
+ *
+ * Lookups are binary searches over contiguous memory, and iteration is
+ * in key order, like std::map. Inserting or erasing an element moves the
+ * elements after it, and invalidates iterators to them. Inserting keys
+ * in increasing order only appends.
+ *
+ * This works best for small tables, and for tables that are built once and
+ * then mostly read, like the tables keyed by 24-bit ICAO addresses.
+ */
+template <typename K, typename V>
+class FlatMap {
+public:
+    typedef std::pair<K, V> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    inline iterator begin() {
+        return _items.begin();
+    }
+    inline iterator end() {
+        return _items.end();
+    }
+    inline const_iterator begin() const {
+        return _items.begin();
+    }
+    inline const_iterator end() const {
+        return _items.end();
+    }
+    inline std::size_t size() const {
+        return _items.size();
+    }
+    inline bool empty() const {
+        return _items.empty();
+    }
+    inline void clear() {
+        _items.clear();
+    }
+    inline void reserve(std::size_t capacity) {
+        _items.reserve(capacity);
+    }
+
+    /** Returns an iterator to the first element with a key not less than key */
+    iterator lower_bound(const K& key) {
+        return std::lower_bound(_items.begin(), _items.end(), key, CompareKey());
+    }
+    const_iterator lower_bound(const K& key) const {
+        return std::lower_bound(_items.begin(), _items.end(), key, CompareKey());
+    }
+
+    iterator find(const K& key) {
+        const auto position = lower_bound(key);
+        return (position != _items.end() && !(key < position->first)) ? position : _items.end();
+    }
+    const_iterator find(const K& key) const {
+        const auto position = lower_bound(key);
+        return (position != _items.end() && !(key < position->first)) ? position : _items.end();
+    }
+
+    /**
+     * Inserts an element if no element with the same key exists
+     *
+     * Returns an iterator to the element with the key, and true if the
+     * element was inserted
+     */
+    std::pair<iterator, bool> insert(const value_type& item) {
+        if (_items.empty() || _items.back().first < item.first) {
+            _items.push_back(item);
+            return std::make_pair(_items.end() - 1, true);
+        }
+        const auto position = lower_bound(item.first);
+        if (position != _items.end() && !(item.first < position->first)) {
+            return std::make_pair(position, false);
+        }
+        return std::make_pair(_items.insert(position, item), true);
+    }
+
+    iterator erase(iterator position) {
+        return _items.erase(position);
+    }
+    std::size_t erase(const K& key) {
+        const auto position = find(key);
+        if (position == _items.end()) {
+            return 0;
+        }
+        _items.erase(position);
+        return 1;
+    }
+
+    /**
+     * Replaces the contents of this map with elements in any order
+     *
+     * If several elements have the same key, the first one is kept.
+     */
+    void assign(std::vector<value_type>&& items) {
+        _items = std::move(items);
+        std::stable_sort(_items.begin(), _items.end(), [](const value_type& a, const value_type& b) {
+            return a.first < b.first;
+        });
+        _items.erase(std::unique(_items.begin(), _items.end(), [](const value_type& a, const value_type& b) {
+            return !(a.first < b.first) && !(b.first < a.first);
+        }), _items.end());
+    }
+
+    /**
+     * Removes the elements with keys in a sorted range
+     *
+     * This moves each element after the first removed one at most once.
+     */
+    template <typename I>
+    void erase_keys(I first, I last) {
+        if (first == last) {
+            return;
+        }
+        auto out = lower_bound(*first);
+        for (auto in = out; in != _items.end(); ++in) {
+            while (first != last && *first < in->first) {
+                ++first;
+            }
+            if (first != last && !(in->first < *first)) {
+                // Remove
+                ++first;
+            } else {
+                if (out != in) {
+                    *out = std::move(*in);
+                }
+                ++out;
+            }
+        }
+        _items.erase(out, _items.end());
+    }
+
+    /** Removes all elements for which predicate returns true */
+    template <typename P>
+    void erase_if(P predicate) {
+        _items.erase(std::remove_if(_items.begin(), _items.end(), predicate), _items.end());
+    }
+
+    friend bool operator == (const FlatMap& a, const FlatMap& b) {
+        return a._items == b._items;
+    }
+    friend bool operator != (const FlatMap& a, const FlatMap& b) {
+        return a._items != b._items;
+    }
+
+private:
+    struct CompareKey {
+        bool operator () (const value_type& item, const K& key) const {
+            return item.first < key;
+        }
+    };
+
+    /** Elements sorted by key */
+    std::vector<value_type> _items;
+};
+
+/**
+ * A set stored as a sorted vector
+ *
+ * See FlatMap for the performance characteristics.
+ */
+template <typename T>
+class FlatSet {
+public:
+    typedef T value_type;
+    typedef typename std::vector<T>::const_iterator iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    inline const_iterator begin() const {
+        return _items.begin();
+    }
+    inline const_iterator end() const {
+        return _items.end();
+    }
+    inline std::size_t size() const {
+        return _items.size();
+    }
+    inline bool empty() const {
+        return _items.empty();
+    }
+    inline void clear() {
+        _items.clear();
+    }
+    inline void reserve(std::size_t capacity) {
+        _items.reserve(capacity);
+    }
+
+    const_iterator find(const T& value) const {
+        const auto position = std::lower_bound(_items.begin(), _items.end(), value);
+        return (position != _items.end() && !(value < *position)) ? position : _items.end();
+    }
+    inline std::size_t count(const T& value) const {
+        return find(value) != _items.end() ? 1 : 0;
+    }
+
+    /** Inserts a value if it is not already present. Returns true if it was inserted. */
+    bool insert(const T& value) {
+        if (_items.empty() || _items.back() < value) {
+            _items.push_back(value);
+            return true;
+        }
+        const auto position = std::lower_bound(_items.begin(), _items.end(), value);
+        if (position != _items.end() && !(value < *position)) {
+            return false;
+        }
+        _items.insert(position, value);
+        return true;
+    }
+
+    std::size_t erase(const T& value) {
+        const auto position = std::lower_bound(_items.begin(), _items.end(), value);
+        if (position == _items.end() || value < *position) {
+            return 0;
+        }
+        _items.erase(position);
+        return 1;
+    }
+
+    friend bool operator == (const FlatSet& a, const FlatSet& b) {
+        return a._items == b._items;
+    }
+    friend bool operator != (const FlatSet& a, const FlatSet& b) {
+        return a._items != b._items;
+    }
+
+private:
+    /** Values in increasing order */
+    std::vector<T> _items;
+};
+
+}
+
+#endif